@@ -0,0 +1,223 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include "GraphS.h"
+#include "GraphMT.h"
+#include "GraphBFS.h"
+#include "GraphHP.h"
+#include "GraphReduced.h"
+#include "VertexOrder.h"
+
+/// <summary>
+/// Busiest worker over the mean busy time, 1 means a perfectly even load
+/// </summary>
+static double Imbalance(const std::vector<lng>& busy)
+{
+    lng total = 0, busiest = 0;
+    for (lng time : busy) {
+        total += time;
+        busiest = std::max(busiest, time);
+    }
+    return total ? (double)busiest * busy.size() / total : 0;
+}
+
+/// <summary>
+/// Hardware events as a JSON object, null if they could not be measured
+/// </summary>
+static void PrintHardwareJson(const HardwareCounters& events, std::ostream& out)
+{
+    if (!events.valid) {
+        out << "null";
+        return;
+    }
+    out << "{\"cycles\": " << events.cycles << ", \"instructions\": " << events.instructions
+        << ", \"llcMisses\": " << events.llcMisses << ", \"dtlbMisses\": " << events.dtlbMisses
+        << ", \"branchMisses\": " << events.branchMisses << "}";
+}
+
+/// <summary>
+/// Latency percentiles of a histogram as a JSON object
+/// </summary>
+static void PrintLatencyJson(const LatencyHistogram& histogram, std::ostream& out)
+{
+    out << "{\"count\": " << histogram.Count() << ", \"p50\": " << histogram.Percentile(0.5)
+        << ", \"p90\": " << histogram.Percentile(0.9) << ", \"p99\": " << histogram.Percentile(0.99)
+        << ", \"max\": " << histogram.Max() << "}";
+}
+
+/// <summary>
+/// Runs every engine on the same graph and compares their work,
+/// then GraphS again on every vertex ordering with the results translated back
+/// </summary>
+/// <param name="edges">Vector of edges</param>
+/// <param name="V">Number of vertices</param>
+/// <param name="num_threads">Threads of the multithreaded engine</param>
+/// <param name="batch">Sources per task of the batched multithreaded engine</param>
+/// <returns>One result per engine</returns>
+std::vector<BenchmarkResult> RunBenchmark(std::vector<Edge>& edges, lng V, size_t num_threads, size_t batch)
+{
+    std::vector<std::pair<std::string, std::unique_ptr<Graph>>> engines;
+    engines.emplace_back("GraphS", std::unique_ptr<Graph>(new GraphS(edges, V)));
+    engines.emplace_back("GraphMT", std::unique_ptr<Graph>(new GraphMT(edges, V, num_threads)));
+    engines.emplace_back("GraphMT/k=" + std::to_string(batch), std::unique_ptr<Graph>(new GraphMT(edges, V, num_threads, batch)));
+    engines.emplace_back("GraphHP", std::unique_ptr<Graph>(new GraphHP(edges, V)));
+    engines.emplace_back("GraphReduced", std::unique_ptr<Graph>(new GraphReduced(edges, V, num_threads)));
+    engines.emplace_back("GraphBFS", std::unique_ptr<Graph>(new GraphBFS(edges, V)));
+
+    std::vector<BenchmarkResult> results;
+    std::vector<std::vector<lng>> reference;
+    lng E = edges.size();
+    double inputSpan = VertexOrder(edges, V, VertexOrdering::Identity).EdgeSpan(edges);
+
+    for (auto& engine : engines) {
+        std::vector<std::vector<lng>> paths(V + 1);
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::vector<std::vector<lng>> distances = engine.second->Johnson(E, paths);
+        auto end_time = std::chrono::high_resolution_clock::now();
+
+        if (results.empty())
+            reference = distances;
+
+        BenchmarkResult result;
+        result.engine = engine.first;
+        result.microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+        result.relaxations = engine.second->Relaxations();
+        result.matches = distances == reference;
+        result.edgeSpan = inputSpan;
+        GraphMT* multithreaded = dynamic_cast<GraphMT*>(engine.second.get());
+        result.imbalance = multithreaded ? Imbalance(multithreaded->WorkerBusyTime()) : 0;
+        if (multithreaded)
+            result.pool = multithreaded->PoolMetrics();
+        result.stats = engine.second->Stats();
+        results.push_back(result);
+    }
+
+    for (VertexOrdering ordering : { VertexOrdering::Bfs, VertexOrdering::Rcm, VertexOrdering::Degree }) {
+        VertexOrder order(edges, V, ordering);
+        std::vector<Edge> relabeled = order.Relabel(edges);
+        GraphS graph(relabeled, V);
+        std::vector<std::vector<lng>> paths(V + 1);
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        order.Restore(distances, paths);
+
+        BenchmarkResult result;
+        result.engine = std::string("GraphS+") + VertexOrder::Name(ordering);
+        result.microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+        result.relaxations = graph.Relaxations();
+        result.matches = distances == reference;
+        result.edgeSpan = order.EdgeSpan(edges);
+        result.imbalance = 0;
+        result.stats = graph.Stats();
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+/// <summary>
+/// Benchmark table output
+/// </summary>
+/// <param name="results">Results of RunBenchmark</param>
+/// <param name="out">Output stream</param>
+void PrintBenchmark(const std::vector<BenchmarkResult>& results, std::ostream& out)
+{
+    out << std::left << std::setw(16) << "engine" << std::right << std::setw(14) << "time (us)"
+        << std::setw(16) << "relaxations" << std::setw(10) << "ratio" << std::setw(10) << "span" << std::setw(10) << "imbalance" << "  matches" << std::endl;
+
+    for (const BenchmarkResult& result : results) {
+        double ratio = results.front().relaxations ? (double)result.relaxations / results.front().relaxations : 0;
+        out << std::left << std::setw(16) << result.engine << std::right << std::setw(14) << result.microseconds
+            << std::setw(16) << result.relaxations << std::setw(10) << std::fixed << std::setprecision(3) << ratio
+            << std::setw(10) << std::setprecision(1) << result.edgeSpan << std::setw(10) << std::setprecision(2) << result.imbalance << "  " << (result.matches ? "yes" : "no") << std::endl;
+    }
+
+    // phases and counters of the engines that fill them
+    out << std::endl << std::left << std::setw(16) << "engine" << std::right;
+    std::vector<std::string> phases = { "load", "output", "bellman-ford", "cycle check", "reweight", "dijkstra" };
+    for (const std::string& phase : phases)
+        out << std::setw(14) << phase;
+    out << std::setw(8) << "passes" << std::setw(14) << "pops" << std::setw(12) << "stale" << std::setw(12) << "decrease" << std::endl;
+
+    for (const BenchmarkResult& result : results) {
+        if (result.stats.phases.empty())
+            continue;
+        out << std::left << std::setw(16) << result.engine << std::right;
+        for (const std::string& phase : phases)
+            out << std::setw(14) << result.stats.Phase(phase);
+        out << std::setw(8) << result.stats.bellmanFordPasses << std::setw(14) << result.stats.counters.pops
+            << std::setw(12) << result.stats.counters.stalePops << std::setw(12) << result.stats.counters.decreaseKeys << std::endl;
+    }
+}
+
+/// <summary>
+/// Benchmark output as JSON, one object per engine with its phases, counters and hardware events
+/// </summary>
+/// <param name="results">Results of RunBenchmark</param>
+/// <param name="out">Output stream</param>
+void PrintBenchmarkJson(const std::vector<BenchmarkResult>& results, std::ostream& out)
+{
+    out << "[" << std::endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        const JohnsonStats& stats = result.stats;
+
+        out << "  {\"engine\": \"" << result.engine << "\", \"microseconds\": " << result.microseconds
+            << ", \"relaxations\": " << result.relaxations << ", \"matches\": " << (result.matches ? "true" : "false")
+            << ", \"edgeSpan\": " << result.edgeSpan << ", \"imbalance\": " << result.imbalance << "," << std::endl;
+
+        out << "   \"phases\": {";
+        for (size_t k = 0; k < stats.phases.size(); k++)
+            out << (k ? ", " : "") << "\"" << stats.phases[k].first << "\": " << stats.phases[k].second;
+        out << "}," << std::endl;
+
+        out << "   \"counters\": {\"pushes\": " << stats.counters.pushes << ", \"pops\": " << stats.counters.pops
+            << ", \"stalePops\": " << stats.counters.stalePops << ", \"decreaseKeys\": " << stats.counters.decreaseKeys
+            << ", \"bellmanFordPasses\": " << stats.bellmanFordPasses << "}," << std::endl;
+
+        out << "   \"hardware\": {";
+        for (size_t k = 0; k < stats.hardware.size(); k++) {
+            out << (k ? ", " : "") << "\"" << stats.hardware[k].first << "\": ";
+            PrintHardwareJson(stats.hardware[k].second, out);
+        }
+        out << "}," << std::endl;
+
+        out << "   \"memory\": {";
+        for (size_t k = 0; k < stats.memory.size(); k++) {
+            const MemoryCounters& memory = stats.memory[k].second;
+            out << (k ? ", " : "") << "\"" << stats.memory[k].first << "\": {\"allocated\": " << memory.allocated
+                << ", \"allocations\": " << memory.allocations << ", \"live\": " << memory.live << ", \"peak\": " << memory.peak << "}";
+        }
+        out << "}," << std::endl;
+        out << "   \"resultBytes\": " << stats.resultBytes << ", \"graphBytes\": " << stats.graphBytes
+            << ", \"peakResidentKilobytes\": " << stats.peakResidentKilobytes << "," << std::endl;
+
+        out << "   \"workerHardware\": ";
+        PrintHardwareJson(stats.workerHardware, out);
+        out << "," << std::endl;
+
+        const ThreadPoolMetrics& pool = result.pool;
+        out << "   \"pool\": ";
+        if (pool.submitted == 0)
+            out << "null";
+        else {
+            out << "{\"submitted\": " << pool.submitted << ", \"completed\": " << pool.completed
+                << ", \"queueDepth\": " << pool.queueDepth << ", \"peakQueueDepth\": " << pool.peakQueueDepth << ", \"idleMicroseconds\": [";
+            for (size_t k = 0; k < pool.idleMicroseconds.size(); k++)
+                out << (k ? ", " : "") << pool.idleMicroseconds[k];
+            out << "]," << std::endl << "    \"queueWaitNanoseconds\": ";
+            PrintLatencyJson(pool.queueWait, out);
+            out << ", \"executionNanoseconds\": ";
+            PrintLatencyJson(pool.execution, out);
+            out << "}";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    out << "]" << std::endl;
+}
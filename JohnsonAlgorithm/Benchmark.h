@@ -0,0 +1,30 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Edge.h"
+#include "JohnsonStats.h"
+#include "PoolMetrics.h"
+
+#define lng long long
+
+/// <summary>
+/// Measurements of one engine on one graph
+/// </summary>
+struct BenchmarkResult {
+    std::string engine;
+    lng microseconds;
+    lng relaxations;
+    bool matches; // distances equal to the first engine
+    double edgeSpan; // mean id distance of the edge endpoints, see VertexOrder::EdgeSpan
+    double imbalance; // busiest worker over the mean worker busy time, 0 if not measured
+    JohnsonStats stats; // phases and counters, empty for engines that do not fill them
+    ThreadPoolMetrics pool; // thread pool of the engine, nothing submitted for engines without one
+};
+
+std::vector<BenchmarkResult> RunBenchmark(std::vector<Edge>& edges, lng V, size_t num_threads, size_t batch);
+
+void PrintBenchmark(const std::vector<BenchmarkResult>& results, std::ostream& out);
+
+void PrintBenchmarkJson(const std::vector<BenchmarkResult>& results, std::ostream& out);
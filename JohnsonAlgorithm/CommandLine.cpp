@@ -0,0 +1,281 @@
+#include "CommandLine.h"
+
+#include <charconv>
+#include <sstream>
+#include "GraphBFS.h"
+#include "GraphHP.h"
+#include "GraphMT.h"
+#include "GraphReduced.h"
+#include "GraphS.h"
+
+/// <summary>
+/// Reads the options of a run. Flags may come in any order, a flag that takes
+/// a value must be followed by it.
+/// </summary>
+/// <param name="options">Receives the options, defaults for the flags not given</param>
+/// <param name="error">Receives the reason if the command line is invalid</param>
+/// <returns>False if the command line is invalid</returns>
+bool CommandLine::Parse(int argc, char* argv[], CommandLine& options, std::string& error)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+
+        // flags without a value
+        if (flag == "--help" || flag == "-h") {
+            options.help = true;
+            continue;
+        }
+        if (flag == "--generate") {
+            options.generate = true;
+            continue;
+        }
+        if (flag == "--bench") {
+            options.bench = true;
+            continue;
+        }
+        if (flag == "--json") {
+            options.json = true;
+            continue;
+        }
+        if (flag == "--perf") {
+            options.perf = true;
+            continue;
+        }
+        if (flag == "--hugepages") {
+            options.hugePages = true;
+            continue;
+        }
+        if (flag == "--pin") {
+            options.placement.pinWorkers = true;
+            continue;
+        }
+        if (flag == "--first-touch") {
+            options.placement.firstTouch = true;
+            continue;
+        }
+        if (flag == "--replicate") {
+            options.placement.replicateCsr = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            error = "missing value of " + flag;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (flag == "--engine") {
+            if (value != "s" && value != "mt" && value != "hp" && value != "reduced" && value != "bfs") {
+                error = "unknown engine " + value;
+                return false;
+            }
+            options.engine = value;
+        }
+        else if (flag == "--threads" || flag == "--batch") {
+            // the whole value must be the number, "4x" is not 4
+            int number = 0;
+            const char* end = value.data() + value.size();
+            std::from_chars_result parsed = std::from_chars(value.data(), end, number);
+            if (parsed.ec != std::errc() || parsed.ptr != end || number < 1) {
+                error = flag + " needs a positive number";
+                return false;
+            }
+            (flag == "--threads" ? options.threads : options.batch) = number;
+        }
+        else if (flag == "--input")
+            options.input = value;
+        else if (flag == "--format") {
+            if (value == "text")
+                options.inputFormat = InputFormat::Text;
+            else if (value == "dimacs")
+                options.inputFormat = InputFormat::Dimacs;
+            else {
+                error = "unknown input format " + value;
+                return false;
+            }
+        }
+        else if (flag == "--queries")
+            options.queries = value;
+        else if (flag == "--output") {
+            if (value == "csv")
+                options.output = OutputFormat::Csv;
+            else if (value == "tsv")
+                options.output = OutputFormat::Tsv;
+            else if (value == "binary")
+                options.output = OutputFormat::Binary;
+            else if (value == "none")
+                options.output = OutputFormat::None;
+            else {
+                error = "unknown output format " + value;
+                return false;
+            }
+        }
+        else if (flag == "--out")
+            options.outputPath = value;
+        else if (flag == "--stats")
+            options.statsPath = value;
+        else if (flag == "--trace")
+            options.tracePath = value;
+        else if (flag == "--order") {
+            if (!VertexOrder::Parse(value, options.ordering)) {
+                error = "unknown vertex ordering " + value;
+                return false;
+            }
+        }
+        else {
+            error = "unknown option " + flag;
+            return false;
+        }
+    }
+    return true;
+}
+
+void CommandLine::PrintUsage(std::ostream& out)
+{
+    out << "Usage: johnson [options]\n"
+        "  --input FILE         graph file (input.txt)\n"
+        "  --format text|dimacs \"V E\" and \"from to weight\" lines, or DIMACS .gr (text)\n"
+        "  --generate           write a random input.txt before reading the input\n"
+        "  --engine s|mt|hp|reduced|bfs\n"
+        "                       solver (mt)\n"
+        "  --threads N          workers of the mt and reduced engines (4)\n"
+        "  --batch K            sources per task of the mt engine (1)\n"
+        "  --order bfs|rcm|degree\n"
+        "                       relabel the vertices for locality, results keep the input ids\n"
+        "  --queries FILE       \"source\" or \"source target\" per line (every pair)\n"
+        "  --output csv|tsv|binary|none\n"
+        "                       format of the shortest paths (csv)\n"
+        "  --out FILE           destination of the shortest paths (standard output)\n"
+        "  --stats FILE         JSON of the phases and counters of the run\n"
+        "  --trace FILE         Chrome trace of the pool and the phases\n"
+        "  --perf               hardware counters of every phase\n"
+        "  --hugepages          huge page advice for large arrays\n"
+        "  --pin, --first-touch, --replicate\n"
+        "                       NUMA placement of the mt engine\n"
+        "  --bench [--json]     compare all engines on the input\n";
+}
+
+/// <summary>
+/// Reads a graph in one of the input formats
+/// </summary>
+/// <param name="edges">Receives the edges</param>
+/// <param name="V">Receives the number of vertices</param>
+/// <param name="error">Receives the reason if the input is invalid</param>
+/// <returns>False if the input is invalid</returns>
+bool ReadGraph(std::istream& in, InputFormat format, std::vector<Edge>& edges, lng& V, std::string& error)
+{
+    edges.clear();
+    lng E = 0, from, to, weight;
+
+    if (format == InputFormat::Text) {
+        if (!(in >> V >> E)) {
+            error = "missing vertex and edge counts";
+            return false;
+        }
+        edges.reserve(E);
+        for (lng i = 0; i < E; ++i) {
+            if (!(in >> from >> to >> weight)) {
+                error = "expected " + std::to_string(E) + " edges, read " + std::to_string(i);
+                return false;
+            }
+            edges.push_back({ from, to, weight });
+        }
+    }
+    else {
+        V = -1;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string kind;
+            if (!(fields >> kind) || kind == "c")
+                continue;
+            if (kind == "p") {
+                std::string problem;
+                if (!(fields >> problem >> V >> E)) {
+                    error = "invalid problem line";
+                    return false;
+                }
+                edges.reserve(E);
+            }
+            else if (kind == "a" && V >= 0 && fields >> from >> to >> weight)
+                edges.push_back({ from, to, weight });
+            else {
+                error = "invalid line: " + line;
+                return false;
+            }
+        }
+        if (V < 0) {
+            error = "missing problem line";
+            return false;
+        }
+        if ((lng)edges.size() != E) {
+            error = "expected " + std::to_string(E) + " arcs, read " + std::to_string(edges.size());
+            return false;
+        }
+    }
+
+    for (const Edge& edge : edges) {
+        if (edge.from < 1 || edge.from > V || edge.to < 1 || edge.to > V) {
+            error = "edge " + std::to_string(edge.from) + " -> " + std::to_string(edge.to) + " is out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Reads queries, one per line: "source" for every target or "source target".
+/// Empty lines and lines starting with # are skipped.
+/// </summary>
+/// <param name="V">Number of vertices, queries must be within 1..V</param>
+/// <param name="queries">Receives the queries in file order</param>
+/// <param name="error">Receives the reason if the file is invalid</param>
+/// <returns>False if the file is invalid</returns>
+bool ReadQueries(std::istream& in, lng V, std::vector<Query>& queries, std::string& error)
+{
+    queries.clear();
+    std::string line;
+    for (lng number = 1; std::getline(in, line); number++) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        lng source, target = 0;
+        if (!(fields >> source)) {
+            error = "line " + std::to_string(number) + " is not a query";
+            return false;
+        }
+        if (!(fields >> std::ws).eof() && !(fields >> target)) {
+            error = "line " + std::to_string(number) + " has an invalid target";
+            return false;
+        }
+        std::string rest;
+        if (fields >> rest) {
+            error = "line " + std::to_string(number) + " has more than a source and a target";
+            return false;
+        }
+        if (source < 1 || source > V || target < 0 || target > V) {
+            error = "line " + std::to_string(number) + " names a vertex outside 1.." + std::to_string(V);
+            return false;
+        }
+        queries.push_back({ source, target });
+    }
+    return true;
+}
+
+/// <summary>
+/// Creates the engine chosen by the options
+/// </summary>
+std::unique_ptr<Graph> MakeEngine(const CommandLine& options, std::vector<Edge>& edges, lng V)
+{
+    if (options.engine == "s")
+        return std::unique_ptr<Graph>(new GraphS(edges, V));
+    if (options.engine == "hp")
+        return std::unique_ptr<Graph>(new GraphHP(edges, V));
+    if (options.engine == "reduced")
+        return std::unique_ptr<Graph>(new GraphReduced(edges, V, options.threads));
+    if (options.engine == "bfs")
+        return std::unique_ptr<Graph>(new GraphBFS(edges, V));
+    return std::unique_ptr<Graph>(new GraphMT(edges, V, options.threads, options.batch, options.placement));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Edge.h"
+#include "Graph.h"
+#include "Placement.h"
+#include "ResultWriter.h"
+#include "VertexOrder.h"
+
+#define lng long long
+
+/// <summary>
+/// Formats of the graph file: "V E" then "from to weight" per edge, or DIMACS
+/// shortest path (.gr: "p sp V E", "a from to weight", "c" comments)
+/// </summary>
+enum class InputFormat {
+    Text,
+    Dimacs
+};
+
+/// <summary>
+/// Options of a non-interactive run, see PrintUsage
+/// </summary>
+struct CommandLine {
+    std::string engine = "mt";
+    size_t threads = 4;
+    size_t batch = 1;
+    std::string input = "input.txt";
+    InputFormat inputFormat = InputFormat::Text;
+    bool generate = false; // write a random input.txt first
+    std::string queries; // empty for every source and target
+    OutputFormat output = OutputFormat::Csv;
+    std::string outputPath; // empty for standard output
+    std::string statsPath; // JSON of the run, empty for none
+    std::string tracePath;
+    bool perf = false;
+    bool hugePages = false;
+    PlacementOptions placement;
+    VertexOrdering ordering = VertexOrdering::Identity;
+    bool bench = false; // compare all engines instead of a run
+    bool json = false;
+    bool help = false;
+
+    static bool Parse(int argc, char* argv[], CommandLine& options, std::string& error);
+
+    static void PrintUsage(std::ostream& out);
+};
+
+bool ReadGraph(std::istream& in, InputFormat format, std::vector<Edge>& edges, lng& V, std::string& error);
+
+bool ReadQueries(std::istream& in, lng V, std::vector<Query>& queries, std::string& error);
+
+std::unique_ptr<Graph> MakeEngine(const CommandLine& options, std::vector<Edge>& edges, lng V);
@@ -0,0 +1,119 @@
+#include "Condensation.h"
+
+#include <algorithm>
+
+/// <summary>
+/// Tarjan's algorithm (iterative) followed by the construction of the condensation DAG
+/// </summary>
+/// <param name="adj_list">Graph adjacency list</param>
+/// <param name="V">Number of vertices</param>
+Condensation::Condensation(const std::vector<std::vector<std::pair<lng, lng>>>& adj_list, lng V)
+{
+    std::vector<lng> index(V + 1, -1), low(V + 1, 0);
+    std::vector<char> onStack(V + 1, 0);
+    std::vector<lng> stack;
+    std::vector<std::pair<lng, size_t>> call; // vertex and next arc to visit
+    lng counter = 0;
+
+    // Tarjan emits a component only after every component reachable from it
+    std::vector<std::vector<lng>> emitted;
+
+    for (lng root = 1; root <= V; root++) {
+        if (index[root] != -1)
+            continue;
+
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = 1;
+        call.push_back({ root, 0 });
+
+        while (!call.empty()) {
+            lng v = call.back().first;
+            size_t i = call.back().second;
+
+            if (i < adj_list[v].size()) {
+                call.back().second++;
+                lng w = adj_list[v][i].first;
+                if (index[w] == -1) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    onStack[w] = 1;
+                    call.push_back({ w, 0 });
+                }
+                else if (onStack[w])
+                    low[v] = std::min(low[v], index[w]);
+                continue;
+            }
+
+            call.pop_back();
+            if (!call.empty())
+                low[call.back().first] = std::min(low[call.back().first], low[v]);
+
+            if (low[v] == index[v]) {
+                emitted.emplace_back();
+                lng w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = 0;
+                    emitted.back().push_back(w);
+                } while (w != v);
+            }
+        }
+    }
+
+    // reverse the emission order to number components topologically
+    lng C = emitted.size();
+    component.assign(V + 1, -1);
+    members.resize(C);
+    for (lng k = 0; k < C; k++) {
+        lng c = C - 1 - k;
+        members[c] = std::move(emitted[k]);
+        std::sort(members[c].begin(), members[c].end());
+        for (lng v : members[c])
+            component[v] = c;
+    }
+
+    dag.resize(C);
+    for (lng v = 1; v <= V; v++)
+        for (const auto& arc : adj_list[v])
+            if (component[arc.first] != component[v])
+                dag[component[v]].push_back(component[arc.first]);
+    for (auto& successors : dag) {
+        std::sort(successors.begin(), successors.end());
+        successors.erase(std::unique(successors.begin(), successors.end()), successors.end());
+    }
+}
+
+/// <summary>
+/// Vertices reachable from the members of component c
+/// </summary>
+/// <param name="c">Component id</param>
+/// <param name="visited">Scratch flags per component, all zero on entry and on return</param>
+/// <returns>Sorted vector of vertices</returns>
+std::vector<lng> Condensation::Reachable(lng c, std::vector<char>& visited) const
+{
+    std::vector<lng> todo = { c };
+    std::vector<lng> seen = { c };
+    std::vector<lng> vertices;
+    visited[c] = 1;
+
+    while (!todo.empty()) {
+        lng x = todo.back();
+        todo.pop_back();
+        vertices.insert(vertices.end(), members[x].begin(), members[x].end());
+        for (lng y : dag[x]) {
+            if (!visited[y]) {
+                visited[y] = 1;
+                todo.push_back(y);
+                seen.push_back(y);
+            }
+        }
+    }
+
+    for (lng x : seen)
+        visited[x] = 0;
+
+    std::sort(vertices.begin(), vertices.end());
+    return vertices;
+}
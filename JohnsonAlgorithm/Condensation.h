@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#define lng long long
+
+/// <summary>
+/// Strongly connected components of a graph and its condensation DAG.
+/// Component ids are in topological order: every DAG arc goes from a lower id to a higher one.
+/// </summary>
+class Condensation
+{
+public:
+    Condensation(const std::vector<std::vector<std::pair<lng, lng>>>& adj_list, lng V);
+
+    lng ComponentCount() const { return (lng)members.size(); }
+
+    /// <summary>
+    /// Component of vertex v, -1 for vertex 0
+    /// </summary>
+    lng Component(lng v) const { return component[v]; }
+
+    const std::vector<lng>& Members(lng c) const { return members[c]; }
+
+    const std::vector<lng>& Successors(lng c) const { return dag[c]; }
+
+    std::vector<lng> Reachable(lng c, std::vector<char>& visited) const;
+
+private:
+    std::vector<lng> component;
+    std::vector<std::vector<lng>> members;
+    std::vector<std::vector<lng>> dag;
+};
@@ -0,0 +1,450 @@
+#include "ContractionHierarchy.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+
+/// <summary>
+/// Witness searches give up after settling this many vertices and keep the shortcut
+/// </summary>
+static const lng witnessSettleLimit = 500;
+
+typedef std::priority_queue<std::pair<lng, lng>, std::vector<std::pair<lng, lng>>,
+    std::greater<std::pair<lng, lng>>> MinQueue;
+
+/// <summary>
+/// Builds the hierarchy from the edges of the graph
+/// </summary>
+/// <param name="edges">Vector of edges with non-negative weights</param>
+/// <param name="V">Number of vertices</param>
+ContractionHierarchy::ContractionHierarchy(const std::vector<Edge>& edges, lng V) : V(V)
+{
+    std::vector<std::vector<Arc>> out(V + 1), in(V + 1);
+
+    for (const Edge& edge : edges) {
+        if (edge.weight < 0)
+            throw std::invalid_argument("contraction hierarchy requires non-negative weights");
+        if (edge.from == edge.to)
+            continue;
+
+        // keep only the lightest of parallel edges
+        bool found = false;
+        for (Arc& arc : out[edge.from]) {
+            if (arc.to == edge.to) {
+                found = true;
+                if (edge.weight < arc.weight) {
+                    arc.weight = edge.weight;
+                    for (Arc& back : in[edge.to])
+                        if (back.to == edge.from)
+                            back.weight = edge.weight;
+                }
+                break;
+            }
+        }
+        if (!found) {
+            out[edge.from].push_back({ edge.to, edge.weight, -1 });
+            in[edge.to].push_back({ edge.from, edge.weight, -1 });
+        }
+    }
+
+    Preprocess(out, in);
+}
+
+/// <summary>
+/// Bounded Dijkstra from src that ignores the vertex being contracted.
+/// Results are left in witnessDist, touched vertices in witnessTouched.
+/// </summary>
+/// <param name="src">Start vertex</param>
+/// <param name="skip">Vertex being contracted</param>
+/// <param name="bound">Largest distance of interest</param>
+/// <param name="out">Outgoing arcs of the remaining graph</param>
+void ContractionHierarchy::WitnessSearch(lng src, lng skip, lng bound, const std::vector<std::vector<Arc>>& out)
+{
+    for (lng v : witnessTouched)
+        witnessDist[v] = LLONG_MAX;
+    witnessTouched.clear();
+
+    MinQueue pq;
+    witnessDist[src] = 0;
+    witnessTouched.push_back(src);
+    pq.push({ 0, src });
+
+    lng settled = 0;
+    while (!pq.empty()) {
+        lng d = pq.top().first;
+        lng f = pq.top().second;
+        pq.pop();
+
+        if (d > witnessDist[f])
+            continue;
+        if (d > bound || ++settled > witnessSettleLimit)
+            break;
+
+        for (const Arc& arc : out[f]) {
+            if (arc.to == skip)
+                continue;
+            if (d + arc.weight < witnessDist[arc.to]) {
+                if (witnessDist[arc.to] == LLONG_MAX)
+                    witnessTouched.push_back(arc.to);
+                witnessDist[arc.to] = d + arc.weight;
+                pq.push({ witnessDist[arc.to], arc.to });
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Counts (and optionally collects) the shortcuts needed to contract x
+/// </summary>
+/// <param name="x">Vertex to contract</param>
+/// <param name="out">Outgoing arcs of the remaining graph</param>
+/// <param name="in">Incoming arcs of the remaining graph</param>
+/// <param name="shortcuts">Receives the shortcuts when not null</param>
+/// <returns>Number of shortcuts</returns>
+lng ContractionHierarchy::SimulateContraction(lng x, const std::vector<std::vector<Arc>>& out,
+    const std::vector<std::vector<Arc>>& in, std::vector<Edge>* shortcuts)
+{
+    if (out[x].empty())
+        return 0;
+
+    lng maxOut = 0;
+    for (const Arc& arc : out[x])
+        maxOut = std::max(maxOut, arc.weight);
+
+    lng count = 0;
+    for (const Arc& inArc : in[x]) {
+        lng u = inArc.to;
+        WitnessSearch(u, x, inArc.weight + maxOut, out);
+
+        for (const Arc& outArc : out[x]) {
+            if (outArc.to == u)
+                continue;
+            lng viaX = inArc.weight + outArc.weight;
+            if (witnessDist[outArc.to] > viaX) {
+                ++count;
+                if (shortcuts)
+                    shortcuts->push_back({ u, outArc.to, viaX });
+            }
+        }
+    }
+    return count;
+}
+
+/// <summary>
+/// Contracts the vertices in edge-difference order and builds the upward CSR arrays
+/// </summary>
+/// <param name="out">Outgoing arcs of the graph</param>
+/// <param name="in">Incoming arcs of the graph</param>
+void ContractionHierarchy::Preprocess(std::vector<std::vector<Arc>>& out, std::vector<std::vector<Arc>>& in)
+{
+    witnessDist.assign(V + 1, LLONG_MAX);
+    witnessTouched.clear();
+
+    rank.assign(V + 1, -1);
+    std::vector<lng> deleted(V + 1, 0);
+
+    /*
+        Priority of a vertex = edge difference + number of contracted neighbours.
+        Priorities are updated lazily: a popped vertex is re-evaluated and pushed
+        back if it is no longer the cheapest one.
+    */
+    auto priority = [&](lng v) {
+        lng added = SimulateContraction(v, out, in, nullptr);
+        return added - (lng)(out[v].size() + in[v].size()) + deleted[v];
+    };
+
+    MinQueue pq;
+    for (lng v = 1; v <= V; v++)
+        pq.push({ priority(v), v });
+
+    std::vector<Edge> shortcuts;
+    lng order = 0;
+    while (!pq.empty()) {
+        lng x = pq.top().second;
+        pq.pop();
+        if (rank[x] != -1)
+            continue;
+
+        lng current = priority(x);
+        if (!pq.empty() && current > pq.top().first) {
+            pq.push({ current, x });
+            continue;
+        }
+
+        shortcuts.clear();
+        SimulateContraction(x, out, in, &shortcuts);
+        rank[x] = order++;
+
+        // detach x from the remaining graph, its own lists become its upward arcs
+        for (const Arc& arc : out[x]) {
+            auto& list = in[arc.to];
+            for (size_t i = 0; i < list.size(); i++)
+                if (list[i].to == x) { list[i] = list.back(); list.pop_back(); break; }
+            deleted[arc.to]++;
+        }
+        for (const Arc& arc : in[x]) {
+            auto& list = out[arc.to];
+            for (size_t i = 0; i < list.size(); i++)
+                if (list[i].to == x) { list[i] = list.back(); list.pop_back(); break; }
+            deleted[arc.to]++;
+        }
+
+        for (const Edge& s : shortcuts) {
+            bool found = false;
+            for (Arc& arc : out[s.from]) {
+                if (arc.to == s.to) {
+                    found = true;
+                    if (s.weight < arc.weight) {
+                        arc.weight = s.weight;
+                        arc.middle = x;
+                        for (Arc& back : in[s.to])
+                            if (back.to == s.from) { back.weight = s.weight; back.middle = x; }
+                    }
+                    break;
+                }
+            }
+            if (!found) {
+                out[s.from].push_back({ s.to, s.weight, x });
+                in[s.to].push_back({ s.from, s.weight, x });
+            }
+        }
+    }
+
+    upOffset.assign(V + 2, 0);
+    downOffset.assign(V + 2, 0);
+    for (lng v = 0; v <= V; v++) {
+        upOffset[v + 1] = upOffset[v] + out[v].size();
+        downOffset[v + 1] = downOffset[v] + in[v].size();
+    }
+    upArcs.clear();
+    downArcs.clear();
+    upArcs.reserve(upOffset[V + 1]);
+    downArcs.reserve(downOffset[V + 1]);
+    for (lng v = 0; v <= V; v++) {
+        upArcs.insert(upArcs.end(), out[v].begin(), out[v].end());
+        downArcs.insert(downArcs.end(), in[v].begin(), in[v].end());
+    }
+
+    witnessDist.clear();
+    witnessDist.shrink_to_fit();
+}
+
+/// <summary>
+/// Number of shortcut arcs added by the preprocessing
+/// </summary>
+lng ContractionHierarchy::ShortcutCount() const
+{
+    lng count = 0;
+    for (const Arc& arc : upArcs)
+        count += arc.middle != -1;
+    for (const Arc& arc : downArcs)
+        count += arc.middle != -1;
+    return count;
+}
+
+/// <summary>
+/// Finds the hierarchy arc from -> to
+/// </summary>
+const ContractionHierarchy::Arc* ContractionHierarchy::FindArc(lng from, lng to) const
+{
+    if (rank[from] < rank[to]) {
+        for (lng i = upOffset[from]; i < upOffset[from + 1]; i++)
+            if (upArcs[i].to == to)
+                return &upArcs[i];
+    }
+    else {
+        for (lng i = downOffset[to]; i < downOffset[to + 1]; i++)
+            if (downArcs[i].to == from)
+                return &downArcs[i];
+    }
+    return nullptr;
+}
+
+/// <summary>
+/// Appends the original vertices of the arc from -> to (without from) to the path
+/// </summary>
+void ContractionHierarchy::Unpack(lng from, lng to, lng middle, std::vector<lng>& path) const
+{
+    std::vector<Edge> stack; // weight field holds the middle vertex
+    stack.push_back({ from, to, middle });
+
+    while (!stack.empty()) {
+        Edge arc = stack.back();
+        stack.pop_back();
+
+        if (arc.weight == -1) {
+            path.push_back(arc.to);
+            continue;
+        }
+
+        lng m = arc.weight;
+        const Arc* first = FindArc(arc.from, m);
+        const Arc* second = FindArc(m, arc.to);
+        stack.push_back({ m, arc.to, second->middle });
+        stack.push_back({ arc.from, m, first->middle });
+    }
+}
+
+/// <summary>
+/// Bidirectional upward search between two vertices
+/// </summary>
+/// <param name="src">Start vertex</param>
+/// <param name="dst">Final vertex</param>
+/// <param name="path">Receives the vertices of the shortest path</param>
+/// <returns>Distance(weight) of the shortest path, LLONG_MAX if dst is unreachable</returns>
+lng ContractionHierarchy::Query(lng src, lng dst, std::vector<lng>& path) const
+{
+    path.clear();
+    if (src == dst) {
+        path.push_back(src);
+        return 0;
+    }
+
+    if ((lng)fwdDist.size() != V + 1) {
+        fwdDist.assign(V + 1, LLONG_MAX);
+        bwdDist.assign(V + 1, LLONG_MAX);
+        fwdParent.assign(V + 1, -1);
+        bwdParent.assign(V + 1, -1);
+        fwdMiddle.assign(V + 1, -1);
+        bwdMiddle.assign(V + 1, -1);
+    }
+
+    MinQueue fq, bq;
+    fwdDist[src] = 0;
+    bwdDist[dst] = 0;
+    touched.push_back(src);
+    touched.push_back(dst);
+    fq.push({ 0, src });
+    bq.push({ 0, dst });
+
+    lng best = LLONG_MAX, meet = -1;
+    while (!fq.empty() || !bq.empty()) {
+        bool forward = bq.empty() || (!fq.empty() && fq.top().first <= bq.top().first);
+        MinQueue& pq = forward ? fq : bq;
+        if (pq.top().first >= best)
+            break;
+
+        lng d = pq.top().first;
+        lng f = pq.top().second;
+        pq.pop();
+
+        std::vector<lng>& dist = forward ? fwdDist : bwdDist;
+        const std::vector<lng>& other = forward ? bwdDist : fwdDist;
+        if (d > dist[f])
+            continue;
+
+        if (other[f] != LLONG_MAX && d + other[f] < best) {
+            best = d + other[f];
+            meet = f;
+        }
+
+        const std::vector<lng>& offset = forward ? upOffset : downOffset;
+        const std::vector<Arc>& arcs = forward ? upArcs : downArcs;
+        std::vector<lng>& parent = forward ? fwdParent : bwdParent;
+        std::vector<lng>& middle = forward ? fwdMiddle : bwdMiddle;
+        for (lng i = offset[f]; i < offset[f + 1]; i++) {
+            const Arc& arc = arcs[i];
+            if (d + arc.weight < dist[arc.to]) {
+                if (fwdDist[arc.to] == LLONG_MAX && bwdDist[arc.to] == LLONG_MAX)
+                    touched.push_back(arc.to);
+                dist[arc.to] = d + arc.weight;
+                parent[arc.to] = f;
+                middle[arc.to] = arc.middle;
+                pq.push({ dist[arc.to], arc.to });
+            }
+        }
+    }
+
+    if (meet != -1) {
+        // upward part src -> meet, collected backwards
+        std::vector<Edge> arcs;
+        for (lng v = meet; v != src; v = fwdParent[v])
+            arcs.push_back({ fwdParent[v], v, fwdMiddle[v] });
+        std::reverse(arcs.begin(), arcs.end());
+        // downward part meet -> dst
+        for (lng v = meet; v != dst; v = bwdParent[v])
+            arcs.push_back({ v, bwdParent[v], bwdMiddle[v] });
+
+        path.push_back(src);
+        for (const Edge& arc : arcs)
+            Unpack(arc.from, arc.to, arc.weight, path);
+    }
+
+    for (lng v : touched) {
+        fwdDist[v] = bwdDist[v] = LLONG_MAX;
+        fwdParent[v] = bwdParent[v] = -1;
+        fwdMiddle[v] = bwdMiddle[v] = -1;
+    }
+    touched.clear();
+
+    return best;
+}
+
+/// <summary>
+/// Writes the hierarchy to a binary file
+/// </summary>
+/// <param name="fileName">Path of the output file</param>
+/// <returns>True on success</returns>
+bool ContractionHierarchy::Save(const std::string& fileName) const
+{
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    auto write = [&file](const void* data, size_t bytes) {
+        file.write(static_cast<const char*>(data), bytes);
+    };
+    auto writeVector = [&](const auto& vec) {
+        lng size = vec.size();
+        write(&size, sizeof(size));
+        write(vec.data(), vec.size() * sizeof(vec[0]));
+    };
+
+    write("JCH1", 4);
+    write(&V, sizeof(V));
+    writeVector(rank);
+    writeVector(upOffset);
+    writeVector(upArcs);
+    writeVector(downOffset);
+    writeVector(downArcs);
+
+    return file.good();
+}
+
+/// <summary>
+/// Reads a hierarchy written by Save
+/// </summary>
+/// <param name="fileName">Path of the input file</param>
+/// <returns>True on success</returns>
+bool ContractionHierarchy::Load(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    auto read = [&file](void* data, size_t bytes) {
+        file.read(static_cast<char*>(data), bytes);
+        return file.good();
+    };
+    auto readVector = [&](auto& vec) {
+        lng size = 0;
+        if (!read(&size, sizeof(size)) || size < 0)
+            return false;
+        vec.resize(size);
+        return read(vec.data(), vec.size() * sizeof(vec[0]));
+    };
+
+    char magic[4];
+    if (!read(magic, 4) || std::memcmp(magic, "JCH1", 4) != 0)
+        return false;
+    if (!read(&V, sizeof(V)) || !readVector(rank) || !readVector(upOffset) || !readVector(upArcs)
+        || !readVector(downOffset) || !readVector(downArcs))
+        return false;
+
+    fwdDist.clear();
+    return (lng)rank.size() == V + 1 && (lng)upOffset.size() == V + 2 && (lng)downOffset.size() == V + 2
+        && upOffset[V + 1] == (lng)upArcs.size() && downOffset[V + 1] == (lng)downArcs.size();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Edge.h"
+
+#define lng long long
+
+/// <summary>
+/// Contraction Hierarchies index for point-to-point shortest path queries.
+/// Vertices are contracted in edge-difference order, shortcuts are added where
+/// no witness path exists, and queries run a bidirectional upward search.
+/// </summary>
+class ContractionHierarchy
+{
+public:
+    ContractionHierarchy() : V(0) {}
+
+    ContractionHierarchy(const std::vector<Edge>& edges, lng V);
+
+    lng Query(lng src, lng dst, std::vector<lng>& path) const;
+
+    bool Save(const std::string& fileName) const;
+    bool Load(const std::string& fileName);
+
+    lng VertexCount() const { return V; }
+    lng ShortcutCount() const;
+
+private:
+    /// <summary>
+    /// Arc of the hierarchy, middle is -1 for an original edge
+    /// </summary>
+    struct Arc {
+        lng to;
+        lng weight;
+        lng middle;
+    };
+
+    lng V;
+    std::vector<lng> rank;
+
+    /*
+        Upward arcs in CSR form:
+        up   - arcs u->v with rank[v] > rank[u], stored at u
+        down - arcs u->v with rank[u] > rank[v], stored at v with to = u
+    */
+    std::vector<lng> upOffset, downOffset;
+    std::vector<Arc> upArcs, downArcs;
+
+    // Scratch space of the query, reused between calls (one query at a time)
+    mutable std::vector<lng> fwdDist, bwdDist, fwdParent, bwdParent, fwdMiddle, bwdMiddle;
+    mutable std::vector<lng> touched;
+
+    void Preprocess(std::vector<std::vector<Arc>>& out, std::vector<std::vector<Arc>>& in);
+    lng SimulateContraction(lng x, const std::vector<std::vector<Arc>>& out,
+        const std::vector<std::vector<Arc>>& in, std::vector<Edge>* shortcuts);
+    void WitnessSearch(lng src, lng skip, lng bound, const std::vector<std::vector<Arc>>& out);
+    const Arc* FindArc(lng from, lng to) const;
+    void Unpack(lng from, lng to, lng middle, std::vector<lng>& path) const;
+
+    // Scratch space of the witness search
+    std::vector<lng> witnessDist;
+    std::vector<lng> witnessTouched;
+};
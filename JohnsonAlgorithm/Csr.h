@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include "MemoryAccounting.h"
+
+#define lng long long
+
+/// <summary>
+/// Adjacency in compressed sparse row form: the arcs of u are
+/// target[offset[u]] .. target[offset[u + 1] - 1] with the matching weights.
+/// Arcs keep the order of adj_list, so searches over it break ties the same way.
+/// The arrays are counted by MemoryAccounting.
+/// </summary>
+template <class W>
+struct Csr {
+    CountedVector<lng> offset;
+    CountedVector<lng> target;
+    CountedVector<W> weight;
+
+    lng Begin(lng u) const { return offset[u]; }
+    lng End(lng u) const { return offset[u + 1]; }
+    lng Arcs() const { return offset.empty() ? 0 : offset.back(); }
+};
@@ -35,7 +35,7 @@ int generateFile() {
     // Open the output file
     std::ofstream outputFile("input.txt");
     if (!outputFile.is_open()) {
-        std::cout << "Failed to open output file." << std::endl;
+        std::cerr << "Failed to open output file." << std::endl;
         return 1;
     }
 
@@ -50,7 +50,7 @@ int generateFile() {
 
     outputFile.close();
 
-    std::cout << "Input data written to 'input.txt'" << std::endl;
+    std::cerr << "Input data written to 'input.txt'" << std::endl;
 
     return 0;
 }
\ No newline at end of file
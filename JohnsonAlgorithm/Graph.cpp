@@ -1,79 +1,419 @@
 #include "Graph.h"
 
+#include <algorithm>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define GRAPH_PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define GRAPH_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define GRAPH_PREFETCH(address)
+#endif
+
 /// <summary>
-/// Bellman-Ford algorithm
+/// Largest reduced weight w + h[u] - h[v] of the arcs leaving the vertices begin .. end - 1
 /// </summary>
-/// <param name="V">Number of vertices</param>
-/// <param name="edges">Vector with edges of graph</param>
-/// <returns>Distance(weight) of the shortest path</returns>
-std::vector<lng> Graph::BellmanFord(lng& V, std::vector<Edge>& edges)
-{
-    /*
-        Step 1 - Add a new vertex 0 to the given graph, add edges of
-        weight 0 from the new vertex to all the existing vertices.
-        edge = {0, u, 0} (1 <= u <= V)
-    */
-    for (int i = 1; i <= V; i++)
-        edges.push_back({ 0, i, 0 });
-
-    /*
-        Step 2 - Find the shortest path from the new vertex to all the other
-        existing vertices using the Bellman-Ford algorithm.
-    */
-    std::vector<lng> dist(V + 1, LLONG_MAX);
-    dist[0] = 0;
+/// <param name="h">Feasible potentials</param>
+/// <returns>Largest reduced weight, 0 if there are no arcs</returns>
+lng Graph::MaxReducedWeight(const std::vector<lng>& h, lng begin, lng end) const
+{
+    lng largest = 0;
+    for (lng u = begin; u < end; u++)
+        for (const auto& arc : adj_list[u])
+            largest = std::max(largest, arc.second + h[u] - h[arc.first]);
+    return largest;
+}
+
+/// <summary>
+/// Chooses the narrowest reduced adjacency that holds maxWeight and sizes it
+/// with the arc offsets of adj_list.
+/// Reduced weights are non-negative, so 16 or 32 unsigned bits are enough for most graphs.
+/// </summary>
+/// <param name="maxWeight">Largest reduced weight</param>
+void Graph::ReserveReduced(lng maxWeight)
+{
+    reduced16 = Csr<uint16_t>();
+    reduced32 = Csr<uint32_t>();
+    reduced64 = Csr<lng>();
 
-    for (int i = 1; i < V; i++)
-        for (auto e : edges)
-            if (dist[e.from] != LLONG_MAX && dist[e.to] > dist[e.from] + e.weight)
-                dist[e.to] = dist[e.from] + e.weight;
+    CountedVector<lng> offset(V + 2, 0);
+    for (lng u = 0; u <= V; u++)
+        offset[u + 1] = offset[u] + adj_list[u].size();
 
-    // the shortest distance values are values of h[]
-    return dist;
+    auto reserve = [&](auto& reduced) {
+        reduced.offset = offset;
+        reduced.target.resize(offset.back());
+        reduced.weight.resize(offset.back());
+    };
+    if (maxWeight <= UINT16_MAX) {
+        reducedWidth = 16;
+        reserve(reduced16);
+    }
+    else if (maxWeight <= UINT32_MAX) {
+        reducedWidth = 32;
+        reserve(reduced32);
+    }
+    else {
+        reducedWidth = 64;
+        reserve(reduced64);
+    }
 }
 
 /// <summary>
-/// Dijkstra's algorithm
+/// Writes the arcs of the vertices begin .. end - 1 with their reduced weights
+/// into the adjacency chosen by ReserveReduced. Ranges do not overlap, so they can be filled in parallel.
+/// </summary>
+/// <param name="h">Feasible potentials</param>
+void Graph::FillReduced(const std::vector<lng>& h, lng begin, lng end)
+{
+    auto fill = [&](auto& reduced) {
+        typedef typename std::decay<decltype(reduced.weight[0])>::type W;
+        for (lng u = begin; u < end; u++) {
+            lng i = reduced.Begin(u);
+            for (const auto& arc : adj_list[u]) {
+                reduced.target[i] = arc.first;
+                reduced.weight[i] = (W)(arc.second + h[u] - h[arc.first]);
+                i++;
+            }
+        }
+    };
+    if (reducedWidth == 16)
+        fill(reduced16);
+    else if (reducedWidth == 32)
+        fill(reduced32);
+    else
+        fill(reduced64);
+}
+
+/// <summary>
+/// Builds the reduced adjacency of the current graph for the potentials h
+/// </summary>
+/// <param name="h">Feasible potentials</param>
+void Graph::BuildReduced(const std::vector<lng>& h)
+{
+    ReserveReduced(MaxReducedWeight(h, 0, V + 1));
+    FillReduced(h, 0, V + 1);
+}
+
+/// <summary>
+/// Dijkstra's algorithm over the reduced adjacency, writing into rows of the result
+/// matrices. The rows must already have V + 1 entries: only their contents are written,
+/// never the vector objects, so workers filling neighbouring rows do not share cache lines.
+/// Distances are corrected by h[v] - h[src] on output.
 /// </summary>
 /// <param name="src">Index of current vertex</param>
-/// <param name="adj_list">Graph adjacency list</param>
-/// <param name="V">Number of vertices</param>
-/// <param name="paths">Vector of the shortest pathes</param>
-/// <returns>Distance(weight) of the shortest path</returns>
-std::vector<lng> Graph::Dijkstra(lng src, std::vector<std::vector<std::pair<lng, lng>>>& adj_list, 
-    lng V, std::vector<std::vector<lng>>& paths)
+/// <param name="h">Potentials the reduced adjacency was built with</param>
+/// <param name="dist">Receives the distances(weight) of the shortest paths</param>
+/// <param name="parent">Receives the parent of every vertex on its shortest path</param>
+/// <param name="counters">Counters of the calling worker</param>
+/// <param name="workspace">Memory of the heap, a pool of the calling worker gets the blocks of the previous source back</param>
+void Graph::ReducedRow(lng src, const std::vector<lng>& h, std::vector<lng>& dist, std::vector<lng>& parent,
+    SearchCounters& counters, std::pmr::memory_resource* workspace)
 {
-    std::vector<lng> dist(V + 1, std::numeric_limits<lng>::max());
+    if (reducedWidth == 16)
+        ReducedRow(reduced16, src, h, dist, parent, counters, workspace);
+    else if (reducedWidth == 32)
+        ReducedRow(reduced32, src, h, dist, parent, counters, workspace);
+    else
+        ReducedRow(reduced64, src, h, dist, parent, counters, workspace);
+}
+
+template <class W>
+void Graph::ReducedRow(const Csr<W>& reduced, lng src, const std::vector<lng>& h,
+    std::vector<lng>& dist, std::vector<lng>& parent, SearchCounters& counters, std::pmr::memory_resource* workspace)
+{
+    std::fill(dist.begin(), dist.end(), LLONG_MAX);
     dist[src] = 0;
 
-    // initialize the Fibonacci heap
-    std::priority_queue<std::pair<lng, lng>, std::vector<std::pair<lng, lng>>, std::greater<std::pair<lng, lng>>> pq;
+    std::fill(parent.begin(), parent.end(), -1);
+    parent[src] = src;
+
+    DistanceHeap pq = MakeHeap(workspace);
     pq.push({ 0, src });
 
-    // initialize the parent array to track the shortest path
-    std::vector<lng> parent(V + 1, -1);
+    STATS_ADD(counters, pushes, 1);
+
+    lng scanned = 0;
+    while (!pq.empty()) {
+        lng d = pq.top().first;
+        lng f = pq.top().second;
+        pq.pop();
+        STATS_ADD(counters, pops, 1);
+        if (d > dist[f]) {
+            STATS_ADD(counters, stalePops, 1);
+            continue;
+        }
+
+        scanned += reduced.End(f) - reduced.Begin(f);
+        for (lng i = reduced.Begin(f); i < reduced.End(f); i++) {
+            lng s = reduced.target[i];
+            lng nd = d + reduced.weight[i];
+            if (nd < dist[s]) {
+                STATS_ADD(counters, decreaseKeys, dist[s] != LLONG_MAX);
+                STATS_ADD(counters, pushes, 1);
+                dist[s] = nd;
+                parent[s] = f;
+                pq.push({ nd, s });
+            }
+        }
+    }
+
+    for (lng v = 1; v <= V; v++)
+        if (dist[v] != LLONG_MAX)
+            dist[v] += h[v] - h[src];
+
+    STATS_ADD(counters, relaxations, scanned);
+    relaxations += scanned;
+}
+
+// GraphMT searches its per-node copies of the reduced adjacency
+template void Graph::ReducedRow(const Csr<uint16_t>&, lng, const std::vector<lng>&,
+    std::vector<lng>&, std::vector<lng>&, SearchCounters&, std::pmr::memory_resource*);
+template void Graph::ReducedRow(const Csr<uint32_t>&, lng, const std::vector<lng>&,
+    std::vector<lng>&, std::vector<lng>&, SearchCounters&, std::pmr::memory_resource*);
+template void Graph::ReducedRow(const Csr<lng>&, lng, const std::vector<lng>&,
+    std::vector<lng>&, std::vector<lng>&, SearchCounters&, std::pmr::memory_resource*);
+
+/// <summary>
+/// Dijkstra's algorithm on the reduced weights w + h[u] - h[v], which are
+/// non-negative for feasible potentials h, distances are restored on return
+/// </summary>
+/// <param name="src">Index of current vertex</param>
+/// <param name="h">Feasible potentials</param>
+/// <param name="parent">Receives the parent of every vertex on its shortest path</param>
+/// <returns>Distance(weight) of the shortest path</returns>
+std::vector<lng> Graph::ReducedDijkstra(lng src, const std::vector<lng>& h, std::vector<lng>& parent)
+{
+    std::vector<lng> dist(V + 1, LLONG_MAX);
+    dist[src] = 0;
+
+    parent.assign(V + 1, -1);
     parent[src] = src;
 
+    DistanceHeap pq = MakeHeap(memory);
+    pq.push({ 0, src });
+
+    lng scanned = 0;
     while (!pq.empty()) {
+        lng d = pq.top().first;
         lng f = pq.top().second;
         pq.pop();
+        if (d > dist[f])
+            continue;
 
+        scanned += adj_list[f].size();
         for (const auto& u : adj_list[f]) {
-            int s = u.first;
-            int w = u.second;
-            if (dist[f] + w < dist[s]) {
-                dist[s] = dist[f] + w;
-                parent[s] = f; // update the parent vertex
+            lng s = u.first;
+            lng w = u.second + h[f] - h[s];
+            if (d + w < dist[s]) {
+                dist[s] = d + w;
+                parent[s] = f;
                 pq.push({ dist[s], s });
             }
         }
     }
 
-    paths[src] = parent;
+    for (lng v = 1; v <= V; v++)
+        if (dist[v] != LLONG_MAX)
+            dist[v] += h[v] - h[src];
 
+    relaxations += scanned;
     return dist;
 }
 
+/// <summary>
+/// Dijkstra from the sources first .. first + count - 1 at once over the reduced adjacency.
+/// The searches take turns settling one vertex each, and every search prefetches the
+/// row it will scan next, so one worker has up to count adjacency misses in flight
+/// and a row needed by several sources is fetched once.
+/// </summary>
+/// <param name="first">First source</param>
+/// <param name="count">Number of sources</param>
+/// <param name="h">Potentials</param>
+/// <param name="path">Receives the distances(weight) of the sources' rows</param>
+/// <param name="paths">Receives the pathes of the sources' rows</param>
+/// <param name="counters">Counters of the calling worker</param>
+/// <param name="workspace">Memory of the heaps</param>
+void Graph::BatchedDijkstra(lng first, lng count, const std::vector<lng>& h,
+    std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths, SearchCounters& counters,
+    std::pmr::memory_resource* workspace)
+{
+    if (reducedWidth == 16)
+        BatchedDijkstra(reduced16, first, count, h, path, paths, counters, workspace);
+    else if (reducedWidth == 32)
+        BatchedDijkstra(reduced32, first, count, h, path, paths, counters, workspace);
+    else
+        BatchedDijkstra(reduced64, first, count, h, path, paths, counters, workspace);
+}
+
+template <class W>
+void Graph::BatchedDijkstra(const Csr<W>& reduced, lng first, lng count, const std::vector<lng>& h,
+    std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths, SearchCounters& counters,
+    std::pmr::memory_resource* workspace)
+{
+    typedef DistanceHeap Queue;
+    std::pmr::vector<Queue> queues(workspace);
+    for (lng j = 0; j < count; j++)
+        queues.push_back(MakeHeap(workspace));
+
+    // rows already have V + 1 entries, see ReducedRow
+    for (lng j = 0; j < count; j++) {
+        lng src = first + j;
+        std::fill(path[src].begin(), path[src].end(), LLONG_MAX);
+        path[src][src] = 0;
+        std::fill(paths[src].begin(), paths[src].end(), -1);
+        paths[src][src] = src;
+        queues[j].push({ 0, src });
+    }
+    STATS_ADD(counters, pushes, count);
+
+    lng scanned = 0;
+    lng active = count;
+    while (active > 0) {
+        active = 0;
+        for (lng j = 0; j < count; j++) {
+            Queue& pq = queues[j];
+            std::vector<lng>& dist = path[first + j];
+
+            // drop outdated entries
+            while (!pq.empty() && pq.top().first > dist[pq.top().second]) {
+                pq.pop();
+                STATS_ADD(counters, pops, 1);
+                STATS_ADD(counters, stalePops, 1);
+            }
+            if (pq.empty())
+                continue;
+            active++;
+
+            lng d = pq.top().first;
+            lng f = pq.top().second;
+            pq.pop();
+            STATS_ADD(counters, pops, 1);
+            if (!pq.empty()) {
+                GRAPH_PREFETCH(reduced.target.data() + reduced.Begin(pq.top().second));
+                GRAPH_PREFETCH(reduced.weight.data() + reduced.Begin(pq.top().second));
+            }
+
+            std::vector<lng>& parent = paths[first + j];
+            scanned += reduced.End(f) - reduced.Begin(f);
+            for (lng i = reduced.Begin(f); i < reduced.End(f); i++) {
+                lng s = reduced.target[i];
+                lng w = reduced.weight[i];
+                if (d + w < dist[s]) {
+                    STATS_ADD(counters, decreaseKeys, dist[s] != LLONG_MAX);
+                    STATS_ADD(counters, pushes, 1);
+                    dist[s] = d + w;
+                    parent[s] = f;
+                    pq.push({ dist[s], s });
+                }
+            }
+        }
+    }
+
+    for (lng j = 0; j < count; j++) {
+        lng src = first + j;
+        for (lng v = 1; v <= V; v++)
+            if (path[src][v] != LLONG_MAX)
+                path[src][v] += h[v] - h[src];
+    }
+
+    STATS_ADD(counters, relaxations, scanned);
+    relaxations += scanned;
+}
+
+template void Graph::BatchedDijkstra(const Csr<uint16_t>&, lng, lng, const std::vector<lng>&,
+    std::vector<std::vector<lng>>&, std::vector<std::vector<lng>>&, SearchCounters&, std::pmr::memory_resource*);
+template void Graph::BatchedDijkstra(const Csr<uint32_t>&, lng, lng, const std::vector<lng>&,
+    std::vector<std::vector<lng>>&, std::vector<std::vector<lng>>&, SearchCounters&, std::pmr::memory_resource*);
+template void Graph::BatchedDijkstra(const Csr<lng>&, lng, lng, const std::vector<lng>&,
+    std::vector<std::vector<lng>>&, std::vector<std::vector<lng>>&, SearchCounters&, std::pmr::memory_resource*);
+
+/// <summary>
+/// Completes stats with the sizes that MemoryAccounting does not see: the result
+/// matrices, the edge list and adjacency list, and the peak resident set
+/// </summary>
+void Graph::FinishStats()
+{
+#if JOHNSON_STATS
+    stats.resultBytes = 2 * (V + 1) * (V + 1) * (lng)sizeof(lng);
+    stats.graphBytes = edges.capacity() * sizeof(Edge) + adj_list.capacity() * sizeof(adj_list[0]);
+    for (const auto& arcs : adj_list)
+        stats.graphBytes += arcs.capacity() * sizeof(arcs[0]);
+    stats.peakResidentKilobytes = MemoryAccounting::PeakResidentKilobytes();
+#endif
+}
+
+/// <summary>
+/// Kahn's algorithm, fills topoOrder and topoPosition
+/// </summary>
+/// <returns>True if every vertex got a position, i.e. the graph is acyclic</returns>
+bool Graph::TopologicalSort()
+{
+    std::vector<lng> inDegree(V + 1, 0);
+    for (lng v = 1; v <= V; v++)
+        for (const auto& u : adj_list[v])
+            inDegree[u.first]++;
+
+    topoOrder.clear();
+    topoOrder.reserve(V);
+    for (lng v = 1; v <= V; v++)
+        if (inDegree[v] == 0)
+            topoOrder.push_back(v);
+
+    for (size_t k = 0; k < topoOrder.size(); k++)
+        for (const auto& u : adj_list[topoOrder[k]])
+            if (--inDegree[u.first] == 0)
+                topoOrder.push_back(u.first);
+
+    if ((lng)topoOrder.size() != V) {
+        topoOrder.clear();
+        return false;
+    }
+
+    topoPosition.assign(V + 1, -1);
+    for (lng k = 0; k < V; k++)
+        topoPosition[topoOrder[k]] = k;
+    return true;
+}
+
+/// <summary>
+/// Shortest paths from one source of an acyclic graph: every vertex after the source
+/// in topological order is relaxed once, so negative weights need no potentials
+/// </summary>
+/// <param name="src">Index of current vertex</param>
+/// <param name="dist">Receives the distances(weight), V + 1 entries like the rows of ReducedRow</param>
+/// <param name="parent">Receives the parent of every vertex on its shortest path</param>
+/// <param name="counters">Counters of the calling worker</param>
+void Graph::DagShortestPaths(lng src, std::vector<lng>& dist, std::vector<lng>& parent, SearchCounters& counters)
+{
+    std::fill(dist.begin(), dist.end(), LLONG_MAX);
+    dist[src] = 0;
+
+    std::fill(parent.begin(), parent.end(), -1);
+    parent[src] = src;
+
+    lng scanned = 0;
+    for (lng k = topoPosition[src]; k < V; k++) {
+        lng f = topoOrder[k];
+        if (dist[f] == LLONG_MAX)
+            continue;
+
+        scanned += adj_list[f].size();
+        for (const auto& u : adj_list[f]) {
+            lng s = u.first;
+            lng w = u.second;
+            if (dist[f] + w < dist[s]) {
+                dist[s] = dist[f] + w;
+                parent[s] = f;
+            }
+        }
+    }
+
+    STATS_ADD(counters, relaxations, scanned);
+    relaxations += scanned;
+}
+
 /// <summary>
 /// Graph output to the console
 /// </summary>
@@ -86,4 +426,323 @@ void Graph::printGraph() {
         std::cout << std::endl;
     }
     std::cout << std::endl;
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Bellman-Ford run separately inside every strongly connected component,
+/// components are processed in topological order and pass their values along the DAG arcs
+/// </summary>
+/// <param name="scc">Strongly connected components of the graph</param>
+/// <param name="negative">Receives 1 for every component containing a negative cycle</param>
+/// <returns>Potentials h[], valid on the part of the graph that reaches no negative cycle</returns>
+std::vector<lng> Graph::CondensedBellmanFord(const Condensation& scc, std::vector<char>& negative)
+{
+    // distances from the added vertex 0, every edge {0, u, 0} gives h[u] <= 0
+    std::vector<lng> h(V + 1, 0);
+    negative.assign(scc.ComponentCount(), 0);
+
+    for (lng c = 0; c < scc.ComponentCount(); c++) {
+        const std::vector<lng>& members = scc.Members(c);
+
+        // a cycle-free component converges after |members| - 1 passes, one more detects a cycle
+        bool changed = true;
+        for (size_t pass = 0; changed && pass <= members.size(); pass++) {
+            STATS_ADD(stats, bellmanFordPasses, 1);
+            changed = false;
+            for (lng u : members)
+                for (const auto& arc : adj_list[u])
+                    if (scc.Component(arc.first) == c && h[u] + arc.second < h[arc.first]) {
+                        h[arc.first] = h[u] + arc.second;
+                        changed = true;
+                    }
+        }
+
+        if (changed) {
+            negative[c] = 1;
+            continue;
+        }
+
+        for (lng u : members)
+            for (const auto& arc : adj_list[u])
+                if (scc.Component(arc.first) != c && h[u] + arc.second < h[arc.first])
+                    h[arc.first] = h[u] + arc.second;
+    }
+
+    return h;
+}
+
+/// <summary>
+/// Allocates the sparse result and marks the sources that reach a negative cycle
+/// </summary>
+/// <param name="scc">Strongly connected components of the graph</param>
+/// <param name="negative">Components containing a negative cycle</param>
+/// <returns>Sparse result without columns and rows</returns>
+SparseDistances Graph::PrepareSparse(const Condensation& scc, const std::vector<char>& negative)
+{
+    lng C = scc.ComponentCount();
+    SparseDistances result;
+    result.block.assign(V + 1, -1);
+    result.undefined.assign(V + 1, 0);
+    result.columns.resize(C);
+    result.dist.resize(V + 1);
+    result.parent.resize(V + 1);
+
+    // reverse topological order: a component is poisoned if any successor is
+    std::vector<char> poisoned(C, 0);
+    for (lng c = C - 1; c >= 0; c--) {
+        poisoned[c] = negative[c];
+        for (lng next : scc.Successors(c))
+            poisoned[c] |= poisoned[next];
+        if (negative[c])
+            result.negativeCycleBlocks.push_back(c);
+    }
+    std::reverse(result.negativeCycleBlocks.begin(), result.negativeCycleBlocks.end());
+
+    for (lng v = 1; v <= V; v++) {
+        result.block[v] = scc.Component(v);
+        result.undefined[v] = poisoned[scc.Component(v)];
+    }
+
+    return result;
+}
+
+/// <summary>
+/// Dijkstra's algorithm for all sources of one component. The sources share the
+/// reachable column list, reduced weights are used and distances restored on output.
+/// </summary>
+/// <param name="c">Component id</param>
+/// <param name="scc">Strongly connected components of the graph</param>
+/// <param name="h">Potentials from CondensedBellmanFord</param>
+/// <param name="result">Sparse result, only columns[c] and rows of the members are written</param>
+void Graph::SparseBlock(lng c, const Condensation& scc, const std::vector<lng>& h, SparseDistances& result)
+{
+    // per-thread scratch, entries are reset after every source
+    thread_local std::vector<char> visited;
+    thread_local std::vector<lng> dist, parent;
+    if ((lng)visited.size() < scc.ComponentCount())
+        visited.resize(scc.ComponentCount(), 0);
+    if ((lng)dist.size() < V + 1) {
+        dist.resize(V + 1, LLONG_MAX);
+        parent.resize(V + 1, -1);
+    }
+
+    const std::vector<lng>& columns = result.columns[c] = scc.Reachable(c, visited);
+
+    lng scanned = 0;
+    for (lng src : scc.Members(c)) {
+        DistanceHeap pq = MakeHeap(memory);
+        dist[src] = 0;
+        parent[src] = src;
+        pq.push({ 0, src });
+
+        while (!pq.empty()) {
+            lng d = pq.top().first;
+            lng f = pq.top().second;
+            pq.pop();
+            if (d > dist[f])
+                continue;
+
+            scanned += adj_list[f].size();
+            for (const auto& u : adj_list[f]) {
+                lng s = u.first;
+                lng w = u.second + h[f] - h[s]; // reduced weight, never negative
+                if (d + w < dist[s]) {
+                    dist[s] = d + w;
+                    parent[s] = f;
+                    pq.push({ dist[s], s });
+                }
+            }
+        }
+
+        std::vector<lng>& row = result.dist[src];
+        std::vector<lng>& rowParent = result.parent[src];
+        row.resize(columns.size());
+        rowParent.resize(columns.size());
+        for (size_t i = 0; i < columns.size(); i++) {
+            lng t = columns[i];
+            row[i] = dist[t] + h[t] - h[src];
+            rowParent[i] = parent[t];
+            dist[t] = LLONG_MAX;
+            parent[t] = -1;
+        }
+    }
+
+    relaxations += scanned;
+}
+
+/// <summary>
+/// Johnson's algorithm over the condensation DAG: negative cycles are searched only
+/// inside components, and only reachable pairs are computed and stored
+/// </summary>
+/// <returns>Distances and parents of the reachable pairs</returns>
+SparseDistances Graph::JohnsonSparse()
+{
+    Condensation scc(adj_list, V);
+
+    std::vector<char> negative;
+    std::vector<lng> h = CondensedBellmanFord(scc, negative);
+
+    SparseDistances result = PrepareSparse(scc, negative);
+    for (lng c = 0; c < scc.ComponentCount(); c++)
+        if (!result.undefined[scc.Members(c).front()])
+            SparseBlock(c, scc, h, result);
+
+    return result;
+}
+
+
+/// <summary>
+/// Potentials h[] for the reweighting, computed once by Bellman-Ford over the
+/// condensation and afterwards repaired locally by InsertEdge and UpdateEdge
+/// </summary>
+/// <returns>Potentials, not meaningful if HasNegativeCycle()</returns>
+const std::vector<lng>& Graph::Potentials()
+{
+    if (!potentialsReady) {
+        Condensation scc(adj_list, V);
+        std::vector<char> negative;
+        potentials = CondensedBellmanFord(scc, negative);
+        negativeCycle = std::find(negative.begin(), negative.end(), 1) != negative.end();
+        potentialsReady = true;
+    }
+    return potentials;
+}
+
+/// <summary>
+/// True if the graph contains a cycle with negative weight
+/// </summary>
+bool Graph::HasNegativeCycle()
+{
+    Potentials();
+    return negativeCycle;
+}
+
+/// <summary>
+/// Keeps the potentials feasible for a new or lighter edge u -> v of weight w.
+/// If its reduced weight r = w + h[u] - h[v] is negative, a Dijkstra on the reduced
+/// graph from v lowers h[x] by -(r + d(v, x)) for the vertices with r + d(v, x) &lt; 0;
+/// reaching u that way means the edge closes a negative cycle.
+/// </summary>
+/// <param name="u">Start vertex</param>
+/// <param name="v">Final vertex</param>
+/// <param name="w">Weight of the edge</param>
+/// <returns>False if the edge closes a negative cycle, the potentials are then unchanged</returns>
+bool Graph::RepairPotentials(lng u, lng v, lng w)
+{
+    std::vector<lng>& h = potentials;
+    lng r = w + h[u] - h[v];
+    if (r >= 0)
+        return true;
+
+    if ((lng)repairDist.size() != V + 1)
+        repairDist.assign(V + 1, LLONG_MAX);
+
+    DistanceHeap pq = MakeHeap(memory);
+    std::vector<lng> touched = { v }, lowered;
+    repairDist[v] = 0;
+    pq.push({ 0, v });
+
+    bool cycle = false;
+    while (!pq.empty()) {
+        lng d = pq.top().first;
+        lng f = pq.top().second;
+        pq.pop();
+        if (d > repairDist[f])
+            continue;
+        if (r + d >= 0)
+            break; // every remaining vertex keeps its potential
+        if (f == u) {
+            cycle = true;
+            break;
+        }
+
+        lowered.push_back(f);
+        for (const auto& arc : adj_list[f]) {
+            lng s = arc.first;
+            lng c = arc.second + h[f] - h[s];
+            if (d + c < repairDist[s]) {
+                if (repairDist[s] == LLONG_MAX)
+                    touched.push_back(s);
+                repairDist[s] = d + c;
+                pq.push({ repairDist[s], s });
+            }
+        }
+    }
+
+    if (!cycle)
+        for (lng x : lowered)
+            h[x] += r + repairDist[x];
+
+    for (lng x : touched)
+        repairDist[x] = LLONG_MAX;
+
+    return !cycle;
+}
+
+/// <summary>
+/// Adds the edge u -> v of weight w without recomputing Bellman-Ford
+/// </summary>
+/// <param name="u">Start vertex</param>
+/// <param name="v">Final vertex</param>
+/// <param name="w">Weight of the edge</param>
+/// <returns>False if the edge would close a negative cycle, the graph is then unchanged</returns>
+bool Graph::InsertEdge(lng u, lng v, lng w)
+{
+    if (!HasNegativeCycle() && !RepairPotentials(u, v, w))
+        return false;
+    if (negativeCycle)
+        potentialsReady = false; // the cycle may be gone, recompute on the next use
+
+    adj_list[u].emplace_back(v, w);
+    edges.push_back({ u, v, w });
+
+    // the topological order survives an edge that goes forward in it
+    if (acyclic && topoPosition[u] >= topoPosition[v])
+        acyclic = TopologicalSort();
+
+    return true;
+}
+
+/// <summary>
+/// Sets the weight of the edge u -> v (all parallel copies), inserts it if there is none
+/// </summary>
+/// <param name="u">Start vertex</param>
+/// <param name="v">Final vertex</param>
+/// <param name="w">New weight</param>
+/// <returns>False if the change would close a negative cycle, the graph is then unchanged</returns>
+bool Graph::UpdateEdge(lng u, lng v, lng w)
+{
+    bool found = false;
+    for (const auto& arc : adj_list[u])
+        found |= arc.first == v;
+    if (!found)
+        return InsertEdge(u, v, w);
+
+    // a heavier edge keeps every reduced weight non-negative
+    if (!HasNegativeCycle() && !RepairPotentials(u, v, w))
+        return false;
+    if (negativeCycle)
+        potentialsReady = false; // the cycle may be gone, recompute on the next use
+
+    for (auto& arc : adj_list[u])
+        if (arc.first == v)
+            arc.second = w;
+    for (Edge& edge : edges)
+        if (edge.from == u && edge.to == v)
+            edge.weight = w;
+
+    return true;
+}
+
+/// <summary>
+/// Single-source shortest paths on the maintained potentials
+/// </summary>
+/// <param name="src">Index of current vertex</param>
+/// <param name="parent">Receives the parent of every vertex on its shortest path</param>
+/// <returns>Distance(weight) of the shortest path, empty if the graph has a negative cycle</returns>
+std::vector<lng> Graph::ShortestPaths(lng src, std::vector<lng>& parent)
+{
+    if (HasNegativeCycle())
+        return std::vector<lng>();
+    return ReducedDijkstra(src, potentials, parent);
+}
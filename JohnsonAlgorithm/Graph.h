@@ -3,11 +3,27 @@
 #include <iostream>
 #include <queue>
 #include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+#include "Csr.h"
 #include "Edge.h"
+#include "JohnsonStats.h"
+#include "Condensation.h"
+#include "SparseDistances.h"
 
 
 #define lng long long
 
+/// <summary>
+/// Min-heap of (distance, vertex) pairs whose storage comes from a memory resource
+/// </summary>
+typedef std::priority_queue<std::pair<lng, lng>, std::pmr::vector<std::pair<lng, lng>>, std::greater<std::pair<lng, lng>>> DistanceHeap;
+
+inline DistanceHeap MakeHeap(std::pmr::memory_resource* memory) {
+    return DistanceHeap(std::greater<std::pair<lng, lng>>(), std::pmr::vector<std::pair<lng, lng>>(memory));
+}
+
 /// <summary>
 /// Basic class of graph
 /// </summary>
@@ -26,19 +42,130 @@ protected:
     /// <param name="edges">Vector of edges</param>
     /// <param name="V">Number of vertices</param>
     Graph(std::vector<Edge>& edges, lng V) : edges(edges), V(V) {
+        auto start_time = std::chrono::high_resolution_clock::now();
         adj_list.resize(V + 1);
         for (const auto& edge : edges)
             adj_list[edge.from].emplace_back(edge.to, edge.weight);
+        acyclic = TopologicalSort();
+        auto end_time = std::chrono::high_resolution_clock::now();
+        loadMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
     }
 
-    std::vector<lng> BellmanFord(lng& V, std::vector<Edge>& edges);
+    /// <summary>
+    /// Time the constructor spent building adj_list and the topological order
+    /// </summary>
+    lng loadMicroseconds;
+
+    /// <summary>
+    /// Upstream of the arenas and worker pools of the solver, shared by the threads,
+    /// so it must be thread safe
+    /// </summary>
+    std::pmr::memory_resource* memory = MemoryAccounting::Resource();
+
+    /// <summary>
+    /// Phases and counters of the last Johnson run, filled by GraphS and GraphMT
+    /// </summary>
+    JohnsonStats stats;
+
+    /// <summary>
+    /// True if the graph has no cycles, Johnson then uses DagShortestPaths
+    /// </summary>
+    bool acyclic;
+    /// <summary>
+    /// Vertices in topological order and the position of every vertex in it
+    /// </summary>
+    std::vector<lng> topoOrder, topoPosition;
+
+    /// <summary>
+    /// Edge relaxations performed by the shortest path searches
+    /// </summary>
+    std::atomic<lng> relaxations{ 0 };
+
+    /// <summary>
+    /// Feasible potentials h[] of Johnson's reweighting, kept up to date by edge changes
+    /// </summary>
+    std::vector<lng> potentials;
+    bool potentialsReady = false;
+    bool negativeCycle = false;
+
+    /// <summary>
+    /// Scratch of RepairPotentials, entries are reset after every call
+    /// </summary>
+    std::vector<lng> repairDist;
+
+    /// <summary>
+    /// Reduced weights w + h[u] - h[v] of the last Johnson run, only the adjacency
+    /// of reducedWidth bits is filled
+    /// </summary>
+    Csr<uint16_t> reduced16;
+    Csr<uint32_t> reduced32;
+    Csr<lng> reduced64;
+    int reducedWidth = 64;
+
+    bool TopologicalSort();
+
+    void FinishStats();
+
+    bool RepairPotentials(lng u, lng v, lng w);
+
+    lng MaxReducedWeight(const std::vector<lng>& h, lng begin, lng end) const;
+
+    void ReserveReduced(lng maxWeight);
+
+    void FillReduced(const std::vector<lng>& h, lng begin, lng end);
+
+    void BuildReduced(const std::vector<lng>& h);
+
+    void ReducedRow(lng src, const std::vector<lng>& h, std::vector<lng>& dist, std::vector<lng>& parent,
+        SearchCounters& counters, std::pmr::memory_resource* workspace);
+
+    template <class W>
+    void ReducedRow(const Csr<W>& reduced, lng src, const std::vector<lng>& h,
+        std::vector<lng>& dist, std::vector<lng>& parent, SearchCounters& counters, std::pmr::memory_resource* workspace);
+
+    void DagShortestPaths(lng src, std::vector<lng>& dist, std::vector<lng>& parent, SearchCounters& counters);
+
+    std::vector<lng> ReducedDijkstra(lng src, const std::vector<lng>& h, std::vector<lng>& parent);
+
+    void BatchedDijkstra(lng first, lng count, const std::vector<lng>& h,
+        std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths, SearchCounters& counters,
+        std::pmr::memory_resource* workspace);
+
+    template <class W>
+    void BatchedDijkstra(const Csr<W>& reduced, lng first, lng count, const std::vector<lng>& h,
+        std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths, SearchCounters& counters,
+        std::pmr::memory_resource* workspace);
+
+    std::vector<lng> CondensedBellmanFord(const Condensation& scc, std::vector<char>& negative);
+
+    SparseDistances PrepareSparse(const Condensation& scc, const std::vector<char>& negative);
 
-    std::vector<lng> Dijkstra(lng src, std::vector<std::vector<std::pair<lng, lng>>>& adj_list, 
-        lng V, std::vector<std::vector<lng>>& paths);
+    void SparseBlock(lng c, const Condensation& scc, const std::vector<lng>& h, SparseDistances& result);
 
 public:
     void printGraph();
 
+    bool IsAcyclic() const { return acyclic; }
+
+    lng Relaxations() const { return relaxations; }
+
+    const JohnsonStats& Stats() const { return stats; }
+
+    /// <summary>
+    /// Sets the upstream of the solver's arenas, MemoryAccounting::Resource() by default
+    /// </summary>
+    void SetMemoryResource(std::pmr::memory_resource* resource) { memory = resource; }
+
+    const std::vector<lng>& Potentials();
+
+    bool HasNegativeCycle();
+
+    bool InsertEdge(lng u, lng v, lng w);
+
+    bool UpdateEdge(lng u, lng v, lng w);
+
+    std::vector<lng> ShortestPaths(lng src, std::vector<lng>& parent);
+
     /// <summary>
     /// Johnson's algorithm 
     /// </summary>
@@ -46,4 +173,10 @@ public:
     /// <param name="paths">Pathes from each vertex to each vertex</param>
     /// <returns>Distances(weight) of the shortest paths</returns>
     virtual std::vector<std::vector<lng>> Johnson(lng E, std::vector<std::vector<lng>>& paths) = 0;
+
+    /// <summary>
+    /// Johnson's algorithm over the condensation DAG with sparse output
+    /// </summary>
+    /// <returns>Distances and parents of the reachable pairs</returns>
+    virtual SparseDistances JohnsonSparse();
 };
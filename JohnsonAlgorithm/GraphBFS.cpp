@@ -0,0 +1,308 @@
+#include "GraphBFS.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GRAPH_BFS_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+typedef GraphBFS::SourceBits SourceBits;
+
+static const int WORDS = GraphBFS::BATCH / 64;
+
+/// <summary>
+/// target |= bits
+/// </summary>
+static inline void Or(SourceBits& target, const SourceBits& bits)
+{
+#ifdef GRAPH_BFS_SSE2
+    for (int k = 0; k < WORDS; k += 2) {
+        __m128i* t = reinterpret_cast<__m128i*>(target.word + k);
+        _mm_store_si128(t, _mm_or_si128(_mm_load_si128(t), _mm_load_si128(reinterpret_cast<const __m128i*>(bits.word + k))));
+    }
+#else
+    for (int k = 0; k < WORDS; k++)
+        target.word[k] |= bits.word[k];
+#endif
+}
+
+/// <summary>
+/// bits &amp; mask
+/// </summary>
+static inline SourceBits And(const SourceBits& bits, const SourceBits& mask)
+{
+    SourceBits result;
+#ifdef GRAPH_BFS_SSE2
+    for (int k = 0; k < WORDS; k += 2)
+        _mm_store_si128(reinterpret_cast<__m128i*>(result.word + k), _mm_and_si128(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(bits.word + k)), _mm_load_si128(reinterpret_cast<const __m128i*>(mask.word + k))));
+#else
+    for (int k = 0; k < WORDS; k++)
+        result.word[k] = bits.word[k] & mask.word[k];
+#endif
+    return result;
+}
+
+/// <summary>
+/// bits &amp; ~mask
+/// </summary>
+static inline SourceBits AndNot(const SourceBits& bits, const SourceBits& mask)
+{
+    SourceBits result;
+#ifdef GRAPH_BFS_SSE2
+    for (int k = 0; k < WORDS; k += 2)
+        _mm_store_si128(reinterpret_cast<__m128i*>(result.word + k), _mm_andnot_si128(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(mask.word + k)), _mm_load_si128(reinterpret_cast<const __m128i*>(bits.word + k))));
+#else
+    for (int k = 0; k < WORDS; k++)
+        result.word[k] = bits.word[k] & ~mask.word[k];
+#endif
+    return result;
+}
+
+static inline bool Any(const SourceBits& bits)
+{
+    uint64_t any = 0;
+    for (int k = 0; k < WORDS; k++)
+        any |= bits.word[k];
+    return any != 0;
+}
+
+static inline int LowestBit(uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+/// <summary>
+/// Calls f with the index of every set bit
+/// </summary>
+template <class F>
+static inline void ForEachBit(const SourceBits& bits, F f)
+{
+    for (int k = 0; k < WORDS; k++)
+        for (uint64_t word = bits.word[k]; word; word &= word - 1)
+            f((lng)k * 64 + LowestBit(word));
+}
+
+/// <summary>
+/// Johnson's algorithm replaced by bit-parallel expansion when the weights allow it
+/// </summary>
+/// <param name="E">Number of edges</param>
+/// <param name="paths">Pathes from each vertex to each vertex</param>
+/// <returns>Distances(weight) of the shortest paths</returns>
+std::vector<std::vector<lng>> GraphBFS::Johnson(lng /*E*/, std::vector<std::vector<lng>>& paths)
+{
+    lng minWeight = LLONG_MAX, maxWeight = 0;
+    for (lng u = 1; u <= V; u++) {
+        for (const auto& arc : adj_list[u]) {
+            minWeight = std::min(minWeight, arc.second);
+            maxWeight = std::max(maxWeight, arc.second);
+        }
+    }
+
+    // one positive weight is a BFS, small non-negative weights fit in buckets
+    bool uniform = minWeight == LLONG_MAX || (minWeight > 0 && minWeight == maxWeight);
+    bool bucketed = minWeight >= 0 && maxWeight < MAX_BUCKET_ENTRIES && (maxWeight + 1) * (V + 1) <= MAX_BUCKET_ENTRIES;
+
+    /*
+        2D matrix to store all-pairs shortest path
+        path[u][v] = shortest path from u to v
+    */
+    std::vector<std::vector<lng>> path(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+
+    if (!uniform && !bucketed) {
+        // Check for negative weight cycle
+        if (HasNegativeCycle()) {
+            return std::vector<std::vector<lng>>(); // return empty vector
+        }
+
+        for (int i = 1; i <= V; i++)
+            path[i] = ShortestPaths(i, paths[i]);
+
+        return path;
+    }
+
+    // reverse adjacency in CSR form, the bucketed expansion finds parents through it
+    std::vector<lng> inOffset;
+    std::vector<std::pair<lng, lng>> inArcs;
+    if (!uniform) {
+        inOffset.assign(V + 2, 0);
+        for (lng u = 1; u <= V; u++)
+            for (const auto& arc : adj_list[u])
+                inOffset[arc.first + 1]++;
+        for (lng v = 0; v <= V; v++)
+            inOffset[v + 1] += inOffset[v];
+        inArcs.resize(inOffset[V + 1]);
+        std::vector<lng> pos(inOffset.begin(), inOffset.end() - 1);
+        for (lng u = 1; u <= V; u++)
+            for (const auto& arc : adj_list[u])
+                inArcs[pos[arc.first]++] = { u, arc.second };
+    }
+
+    for (lng first = 1; first <= V; first += BATCH) {
+        lng count = std::min<lng>(BATCH, V - first + 1);
+        if (uniform)
+            MultiSourceBfs(first, count, minWeight == LLONG_MAX ? 1 : minWeight, path, paths);
+        else
+            MultiSourceBuckets(first, count, maxWeight, inOffset, inArcs, path, paths);
+    }
+
+    return path;
+}
+
+/// <summary>
+/// Multi-source BFS: a vertex passes the bits of its frontier sources to its neighbours
+/// with one OR/ANDNOT per edge instead of one relaxation per source
+/// </summary>
+/// <param name="first">First source of the batch</param>
+/// <param name="count">Number of sources in the batch</param>
+/// <param name="step">Weight of every edge</param>
+/// <param name="path">Receives the distances(weight) of the sources' rows</param>
+/// <param name="paths">Receives the pathes of the sources' rows</param>
+void GraphBFS::MultiSourceBfs(lng first, lng count, lng step, std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths)
+{
+    std::vector<SourceBits> seen(V + 1), visit(V + 1), next(V + 1);
+    std::vector<lng> frontier, upcoming;
+
+    for (lng i = 0; i < count; i++) {
+        lng src = first + i;
+        seen[src].word[i / 64] |= 1ull << (i % 64);
+        visit[src] = seen[src];
+        path[src][src] = 0;
+        paths[src].assign(V + 1, -1);
+        paths[src][src] = src;
+        frontier.push_back(src);
+    }
+
+    lng scanned = 0;
+    for (lng level = 1; !frontier.empty(); level++) {
+        for (lng v : frontier) {
+            scanned += adj_list[v].size();
+            for (const auto& arc : adj_list[v]) {
+                lng n = arc.first;
+                SourceBits reached = AndNot(visit[v], seen[n]);
+                if (!Any(reached))
+                    continue;
+
+                if (!Any(next[n]))
+                    upcoming.push_back(n);
+                Or(next[n], reached);
+                Or(seen[n], reached);
+                ForEachBit(reached, [&](lng i) {
+                    path[first + i][n] = level * step;
+                    paths[first + i][n] = v;
+                });
+            }
+        }
+
+        for (lng v : frontier)
+            visit[v] = SourceBits();
+        for (lng n : upcoming) {
+            visit[n] = next[n];
+            next[n] = SourceBits();
+        }
+        frontier.swap(upcoming);
+        upcoming.clear();
+    }
+
+    relaxations += scanned;
+}
+
+/// <summary>
+/// Multi-source Dial's algorithm: bucket d % (maxWeight + 1) holds, for every vertex,
+/// the sources that reach it at distance d. A vertex settles all its bits of the
+/// current bucket at once; the parent of a source is an in-neighbour settled before
+/// for the same source at distance d - w.
+/// </summary>
+/// <param name="first">First source of the batch</param>
+/// <param name="count">Number of sources in the batch</param>
+/// <param name="maxWeight">Largest edge weight</param>
+/// <param name="inOffset">CSR offsets of the reverse adjacency</param>
+/// <param name="inArcs">CSR arcs of the reverse adjacency</param>
+/// <param name="path">Receives the distances(weight) of the sources' rows</param>
+/// <param name="paths">Receives the pathes of the sources' rows</param>
+void GraphBFS::MultiSourceBuckets(lng first, lng count, lng maxWeight, const std::vector<lng>& inOffset,
+    const std::vector<std::pair<lng, lng>>& inArcs, std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths)
+{
+    lng slots = maxWeight + 1;
+    std::vector<std::vector<SourceBits>> bucket(slots, std::vector<SourceBits>(V + 1));
+    std::vector<std::vector<lng>> list(slots);
+    std::vector<SourceBits> settled(V + 1);
+
+    for (lng i = 0; i < count; i++) {
+        lng src = first + i;
+        bucket[0][src].word[i / 64] |= 1ull << (i % 64);
+        list[0].push_back(src);
+        paths[src].assign(V + 1, -1);
+    }
+
+    lng scanned = 0;
+    lng empty = 0; // consecutive empty buckets, a full round of them ends the search
+    for (lng d = 0; empty < slots; d++) {
+        lng k = d % slots;
+        std::vector<lng>& todo = list[k];
+        if (todo.empty()) {
+            empty++;
+            continue;
+        }
+        empty = 0;
+
+        // edges of weight 0 append to the list being processed
+        for (size_t j = 0; j < todo.size(); j++) {
+            lng v = todo[j];
+            SourceBits reached = AndNot(bucket[k][v], settled[v]);
+            bucket[k][v] = SourceBits();
+            if (!Any(reached))
+                continue;
+            Or(settled[v], reached);
+
+            SourceBits open = reached;
+            ForEachBit(reached, [&](lng i) {
+                path[first + i][v] = d;
+                if (first + i == v) {
+                    paths[v][v] = v;
+                    open.word[i / 64] &= ~(1ull << (i % 64));
+                }
+            });
+            for (lng a = inOffset[v]; a < inOffset[v + 1] && Any(open); a++) {
+                lng u = inArcs[a].first;
+                lng w = inArcs[a].second;
+                if (u == v || w > d)
+                    continue;
+                ForEachBit(And(open, settled[u]), [&](lng i) {
+                    if (path[first + i][u] == d - w) {
+                        paths[first + i][v] = u;
+                        open.word[i / 64] &= ~(1ull << (i % 64));
+                    }
+                });
+            }
+
+            scanned += adj_list[v].size();
+            for (const auto& arc : adj_list[v]) {
+                lng n = arc.first;
+                SourceBits pending = AndNot(reached, settled[n]);
+                if (!Any(pending))
+                    continue;
+
+                lng t = (d + arc.second) % slots;
+                if (!Any(bucket[t][n]))
+                    list[t].push_back(n);
+                Or(bucket[t][n], pending);
+            }
+        }
+        todo.clear();
+    }
+
+    relaxations += scanned;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include "Graph.h"
+
+/// <summary>
+/// Realization of graph for unit and small integer weights: batches of 256 sources
+/// are expanded together, every vertex keeps one bit per source of the batch.
+/// Graphs with negative or large weights fall back to Dijkstra on the potentials.
+/// </summary>
+class GraphBFS : public Graph {
+public:
+    GraphBFS(std::vector<Edge>& edges, lng V) : Graph(edges, V) {}
+
+    std::vector<std::vector<lng>> Johnson(lng E, std::vector<std::vector<lng>>& paths) override;
+
+    /// <summary>
+    /// Sources expanded together
+    /// </summary>
+    static const int BATCH = 256;
+
+    /// <summary>
+    /// Largest (maxWeight + 1) * (V + 1) for which the bucketed expansion keeps its buckets
+    /// </summary>
+    static const lng MAX_BUCKET_ENTRIES = 1 << 21;
+
+    /// <summary>
+    /// One bit per source of a batch
+    /// </summary>
+    struct SourceBits {
+        alignas(16) uint64_t word[BATCH / 64];
+    };
+
+private:
+    void MultiSourceBfs(lng first, lng count, lng step, std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths);
+
+    void MultiSourceBuckets(lng first, lng count, lng maxWeight, const std::vector<lng>& inOffset,
+        const std::vector<std::pair<lng, lng>>& inArcs, std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths);
+};
@@ -0,0 +1,149 @@
+#include "GraphDynamic.h"
+
+/// <summary>
+/// Johnson's algorithm that keeps potentials, distances and parents for later updates
+/// </summary>
+/// <param name="E">Number of edges</param>
+/// <param name="paths">Pathes from each vertex to each vertex</param>
+/// <returns>Distances(weight) of the shortest paths</returns>
+std::vector<std::vector<lng>> GraphDynamic::Johnson(lng /*E*/, std::vector<std::vector<lng>>& paths)
+{
+    // potentials are maintained by the base class across the updates
+    if (HasNegativeCycle()) {
+        ready = false;
+        return std::vector<std::vector<lng>>(); // return empty vector
+    }
+
+    dist.assign(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+    parent.assign(V + 1, std::vector<lng>());
+    for (int i = 1; i <= V; i++)
+        dist[i] = ShortestPaths(i, parent[i]);
+
+    ready = true;
+    touchedRows = V;
+    paths = parent;
+
+    return dist;
+}
+
+/// <summary>
+/// Weight of the lightest edge u -> v
+/// </summary>
+/// <returns>Weight, LLONG_MAX if there is no such edge</returns>
+lng GraphDynamic::EdgeWeight(lng u, lng v) const
+{
+    lng weight = LLONG_MAX;
+    for (const auto& arc : adj_list[u])
+        if (arc.first == v && arc.second < weight)
+            weight = arc.second;
+    return weight;
+}
+
+/// <summary>
+/// An edge u -> v of weight w closes a negative cycle if the path v -> u is shorter than -w
+/// </summary>
+bool GraphDynamic::CreatesNegativeCycle(lng u, lng v, lng w) const
+{
+    return dist[v][u] != LLONG_MAX && dist[v][u] + w < 0;
+}
+
+/// <summary>
+/// Sets the weight of the edge u -> v (all parallel copies), inserts it if there is none
+/// </summary>
+/// <param name="u">Start vertex</param>
+/// <param name="v">Final vertex</param>
+/// <param name="w">New weight</param>
+/// <returns>Number of touched rows, -1 if the change was rejected because of a negative cycle</returns>
+lng GraphDynamic::UpdateEdge(lng u, lng v, lng w)
+{
+    lng old = EdgeWeight(u, v);
+    if (old == LLONG_MAX)
+        return InsertEdge(u, v, w);
+
+    if (ready && w < old && CreatesNegativeCycle(u, v, w)) {
+        return touchedRows = -1;
+    }
+
+    if (!Graph::UpdateEdge(u, v, w)) {
+        return touchedRows = -1;
+    }
+
+    if (!ready)
+        return touchedRows = 0;
+    if (w < old)
+        return touchedRows = Decrease(u, v, w);
+    if (w > old)
+        return touchedRows = Increase(u, v, old);
+    return touchedRows = 0;
+}
+
+/// <summary>
+/// Adds the edge u -> v, a lighter edge than the existing ones is propagated
+/// </summary>
+/// <param name="u">Start vertex</param>
+/// <param name="v">Final vertex</param>
+/// <param name="w">Weight</param>
+/// <returns>Number of touched rows, -1 if the change was rejected because of a negative cycle</returns>
+lng GraphDynamic::InsertEdge(lng u, lng v, lng w)
+{
+    if (ready && CreatesNegativeCycle(u, v, w)) {
+        return touchedRows = -1;
+    }
+
+    lng old = EdgeWeight(u, v);
+    if (!Graph::InsertEdge(u, v, w)) {
+        return touchedRows = -1;
+    }
+
+    if (!ready || w >= old)
+        return touchedRows = 0;
+    return touchedRows = Decrease(u, v, w);
+}
+
+/// <summary>
+/// The edge u -> v became lighter. Paths from v do not change (no negative cycle),
+/// so a row x improves exactly when x -> u -> v beats its distance to v, and then
+/// dist[x][y] = min(dist[x][y], dist[x][u] + w + dist[v][y]).
+/// </summary>
+/// <returns>Number of touched rows</returns>
+lng GraphDynamic::Decrease(lng u, lng v, lng w)
+{
+    lng touched = 0;
+    for (lng x = 1; x <= V; x++) {
+        if (dist[x][u] == LLONG_MAX)
+            continue;
+        lng base = dist[x][u] + w;
+        if (base >= dist[x][v])
+            continue;
+
+        touched++;
+        std::vector<lng>& row = dist[x];
+        std::vector<lng>& rowParent = parent[x];
+        for (lng y = 1; y <= V; y++) {
+            if (dist[v][y] == LLONG_MAX || base + dist[v][y] >= row[y])
+                continue;
+            row[y] = base + dist[v][y];
+            rowParent[y] = (y == v) ? u : parent[v][y];
+        }
+    }
+    return touched;
+}
+
+/// <summary>
+/// The edge u -> v became heavier. Only rows whose shortest path tree used it can change,
+/// they are recomputed; the potentials stay feasible because no weight decreased.
+/// </summary>
+/// <param name="w">Previous weight of the edge</param>
+/// <returns>Number of touched rows</returns>
+lng GraphDynamic::Increase(lng u, lng v, lng w)
+{
+    lng touched = 0;
+    for (lng x = 1; x <= V; x++) {
+        if (x == v || parent[x][v] != u || dist[x][u] == LLONG_MAX || dist[x][u] + w != dist[x][v])
+            continue;
+
+        touched++;
+        dist[x] = ShortestPaths(x, parent[x]);
+    }
+    return touched;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Graph.h"
+
+/// <summary>
+/// Realization of graph that keeps its all-pairs result and repairs it after edge changes
+/// </summary>
+class GraphDynamic : public Graph {
+public:
+    GraphDynamic(std::vector<Edge>& edges, lng V) : Graph(edges, V), ready(false), touchedRows(0) {}
+
+    std::vector<std::vector<lng>> Johnson(lng E, std::vector<std::vector<lng>>& paths) override;
+
+    lng UpdateEdge(lng u, lng v, lng w);
+    lng InsertEdge(lng u, lng v, lng w);
+
+    const std::vector<std::vector<lng>>& Distances() const { return dist; }
+    const std::vector<std::vector<lng>>& Parents() const { return parent; }
+
+    /// <summary>
+    /// Rows of the matrices touched by the last update
+    /// </summary>
+    lng TouchedRows() const { return touchedRows; }
+
+private:
+    bool ready;
+    lng touchedRows;
+    std::vector<std::vector<lng>> dist;
+    std::vector<std::vector<lng>> parent;
+
+    lng EdgeWeight(lng u, lng v) const;
+    bool CreatesNegativeCycle(lng u, lng v, lng w) const;
+    lng Decrease(lng u, lng v, lng w);
+    lng Increase(lng u, lng v, lng w);
+};
@@ -0,0 +1,102 @@
+#include "GraphHP.h"
+
+#include <tuple>
+
+/// <summary>
+/// Johnson's algorithm with hidden paths instead of V independent Dijkstra runs
+/// </summary>
+/// <param name="E">Number of edges</param>
+/// <param name="paths">Pathes from each vertex to each vertex</param>
+/// <returns>Distances(weight) of the shortest paths</returns>
+std::vector<std::vector<lng>> GraphHP::Johnson(lng /*E*/, std::vector<std::vector<lng>>& paths)
+{
+    // Check for negative weight cycle
+    if (HasNegativeCycle())
+    {
+        return std::vector<std::vector<lng>>(); // return empty vector
+    }
+
+    // the shortest distance values are values of h[], kept by the graph between runs
+    const std::vector<lng>& h = Potentials();
+
+    /*
+        2D matrix to store all-pairs shortest path
+        path[u][v] = shortest path from u to v, in reduced weights w + h[u] - h[v] until the end
+    */
+    std::vector<std::vector<lng>> path(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+    std::vector<std::vector<char>> settled(V + 1, std::vector<char>(V + 1, 0));
+    for (int i = 1; i <= V; i++) {
+        paths[i].assign(V + 1, -1);
+        paths[i][i] = i;
+    }
+
+    // reduced weights w + h[u] - h[v] are non-negative
+    std::vector<std::vector<std::pair<lng, lng>>> reduced(V + 1);
+    for (lng u = 1; u <= V; u++)
+        for (const auto& arc : adj_list[u])
+            reduced[u].emplace_back(arc.first, arc.second + h[u] - h[arc.first]);
+
+    /*
+        optimal[v]      - edges (v, w) known to be shortest paths
+        settledInto[v]  - sources x whose distance to v is final
+    */
+    std::vector<std::vector<std::pair<lng, lng>>> optimal(V + 1);
+    std::vector<std::vector<lng>> settledInto(V + 1);
+
+    typedef std::tuple<lng, lng, lng> Pair; // distance, source, target
+    std::priority_queue<Pair, std::vector<Pair>, std::greater<Pair>> pq;
+
+    lng relaxed = 0;
+    auto relax = [&](lng u, lng v, lng d, lng parent) {
+        relaxed++;
+        if (d < path[u][v]) {
+            path[u][v] = d;
+            paths[u][v] = parent;
+            pq.push(Pair(d, u, v));
+        }
+    };
+
+    for (lng u = 1; u <= V; u++) {
+        path[u][u] = 0;
+        pq.push(Pair(0, u, u));
+        for (const auto& arc : reduced[u])
+            relax(u, arc.first, arc.second, u);
+    }
+
+    while (!pq.empty()) {
+        lng d, u, v;
+        std::tie(d, u, v) = pq.top();
+        pq.pop();
+        if (settled[u][v] || d > path[u][v])
+            continue;
+        settled[u][v] = 1;
+
+        // extend u -> v by the optimal edges leaving v
+        for (const auto& arc : optimal[v])
+            if (!settled[u][arc.first])
+                relax(u, arc.first, d + arc.second, v);
+
+        /*
+            Parent u means the shortest path is the edge u -> v itself, so the edge
+            becomes optimal and extends every path already known to end in u
+        */
+        if (u != v && paths[u][v] == u) {
+            optimal[u].emplace_back(v, d);
+            for (lng x : settledInto[u])
+                if (!settled[x][v])
+                    relax(x, v, path[x][u] + d, u);
+        }
+
+        settledInto[v].push_back(u);
+    }
+
+    relaxations += relaxed;
+
+    // restore the original weights
+    for (lng u = 1; u <= V; u++)
+        for (lng v = 1; v <= V; v++)
+            if (path[u][v] != LLONG_MAX)
+                path[u][v] += h[v] - h[u];
+
+    return path;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "Graph.h"
+
+/// <summary>
+/// Realization of graph with the hidden paths algorithm (Karger, Koller, Phillips):
+/// all sources share one priority queue and only edges that are shortest paths
+/// themselves are relaxed
+/// </summary>
+class GraphHP : public Graph {
+public:
+    GraphHP(std::vector<Edge>& edges, lng V) : Graph(edges, V) {}
+
+    std::vector<std::vector<lng>> Johnson(lng E, std::vector<std::vector<lng>>& paths) override;
+};
@@ -1,54 +1,571 @@
 #include "GraphMT.h"
 
+#include <algorithm>
+#include <map>
+
 /// <summary>
 /// Johnson's algorithm with multithreading
 /// </summary>
 /// <param name="E">Number of edges</param>
 /// <param name="paths">Pathes from each vertex to each vertex</param>
 /// <returns>Distances(weight) of the shortest paths</returns>
-std::vector<std::vector<lng>> GraphMT::Johnson(lng E, std::vector<std::vector<lng>>& paths) {
-    // Start time measurement
-    auto start_time = std::chrono::high_resolution_clock::now();
+std::vector<std::vector<lng>> GraphMT::Johnson(lng /*E*/, std::vector<std::vector<lng>>& paths) {
+    stats = JohnsonStats();
+    PhaseTimer timer(stats);
+    timer.Record("load", loadMicroseconds);
+
+    // bookkeeping of the run, released at once when it returns
+    std::pmr::monotonic_buffer_resource arena(memory);
+
+    // every task counts into its own slots, summed when the tasks are done
+    std::pmr::vector<SearchCounters> taskCounters(&arena);
+    std::pmr::vector<HardwareCounters> taskHardware(&arena);
+    auto finish = [&]() {
+        for (const SearchCounters& counters : taskCounters)
+            stats.counters += counters;
+        for (const HardwareCounters& events : taskHardware)
+            stats.workerHardware += events;
+        FinishStats();
+    };
+
+    /*
+        Rows of both matrices are allocated here, before any task starts: workers only
+        write row contents, and one latch replaces a future per task. With first touch
+        the worker that computes a row allocates it, so its pages are on the worker's node.
+    */
+    bool workerRows = placement.firstTouch && !acyclic;
+    if (!workerRows) {
+        for (int i = 1; i <= V; i++)
+            PlaceRow(paths[i]);
+    }
+    timer.Mark("output");
 
-    // the shortest distance values are values of h[]
-    std::vector<lng> h = BellmanFord(V, edges);
+    // No cycles, so no negative cycles either: relax in topological order without potentials
+    if (acyclic) {
+        std::vector<std::vector<lng>> path(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+        timer.Mark("output");
 
-    // Check for negative weight cycle
-    for (const Edge& edge : edges) {
-        if (h[edge.from] != LLONG_MAX && h[edge.to] > h[edge.from] + edge.weight) {
-            std::cout << "The graph contains a cycle with negative weight." << std::endl;
-            return std::vector<std::vector<lng>>(); // return empty vector
+        // Sources are independent, each one is a task of the pool
+        taskCounters.resize(V + 1);
+        taskHardware.resize(V + 1);
+        Latch done(V);
+        for (int i = 1; i <= V; i++) {
+            pool.Submit([&, i] {
+                PerfScope scope;
+                DagShortestPaths(i, path[i], paths[i], taskCounters[i]);
+                taskHardware[i] = scope.Read();
+                done.CountDown();
+            });
         }
+        done.Wait();
+        timer.Mark("dijkstra");
+
+        finish();
+        return path;
     }
 
-    // Update edge weights
-    for (int i = 0; i < E; i++) {
-        lng u = edges[i].from;
-        lng v = edges[i].to;
-        edges[i].weight += (h[u] - h[v]);
+    // the shortest distance values are values of h[], kept by the graph between runs
+    const std::vector<lng>& h = Potentials();
+    timer.Mark("bellman-ford");
+
+    // Check for negative weight cycle: every cycle has an edge the potentials cannot satisfy
+    if (!FeasiblePotentials(h)) {
+        return std::vector<std::vector<lng>>(); // return empty vector
     }
+    timer.Mark("cycle check");
+
+    /*
+        Reduced weights go to their own adjacency in the narrowest type that holds the
+        largest of them; the ranges find their maxima, then fill their own arcs
+    */
+    std::pmr::vector<lng> rangeMax(std::max<size_t>(1, pool.Size()), 0, &arena);
+    ParallelFor(0, V + 1, [&](lng begin, lng end, lng range) {
+        rangeMax[range] = MaxReducedWeight(h, begin, end);
+    });
+    ReserveReduced(*std::max_element(rangeMax.begin(), rangeMax.end()));
+    ParallelFor(0, V + 1, [&](lng begin, lng end, lng) {
+        FillReduced(h, begin, end);
+    });
+    timer.Mark("reweight");
 
     /*
         2D matrix to store all-pairs shortest path
         path[u][v] = shortest path from u to v
     */
-    std::vector<std::vector<lng>> path(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+    std::vector<std::vector<lng>> path(V + 1);
+    path[0].assign(V + 1, LLONG_MAX);
+    if (!workerRows) {
+        for (int i = 1; i <= V; i++)
+            PlaceRow(path[i]);
+    }
+    timer.Mark("output");
 
-    // Parallelize Dijkstra's algorithm using a thread pool
-    std::vector<std::future<std::vector<lng>>> futures;
-    for (int i = 1; i <= V; i++) {
-        futures.emplace_back(pool.Enqueue(&GraphMT::Dijkstra, this, i, std::ref(adj_list), V, std::ref(paths)));
+    // every node reads its own copy of the reduced adjacency if all copies fit in half of the free memory
+    replicas.clear();
+    int nodes = Placement::NodeCount();
+    if (placement.replicateCsr && nodes > 1 && ReducedBytes() * nodes <= Placement::AvailableBytes() / 2) {
+        for (int n = 0; n < nodes; n++)
+            replicas.emplace_back(new ReducedReplica());
     }
 
-    // Collect the results from the futures
-    for (int i = 1; i <= V; i++) {
-        path[i] = futures[i - 1].get();
+    // Batches of sources share one worker and interleave their searches
+    if (batch > 1) {
+        workerBusy.assign(std::max<size_t>(1, pool.Size()), 0);
+        taskCounters.resize((V + batch - 1) / batch);
+        taskHardware.resize(taskCounters.size());
+        Latch done(taskCounters.size());
+        for (lng first = 1; first <= V; first += batch) {
+            lng count = std::min<lng>(batch, V - first + 1);
+            pool.Submit([&, first, count] {
+                PerfScope scope;
+                SearchCounters counters;
+                std::pmr::unsynchronized_pool_resource workspace(memory);
+                auto busy_start = std::chrono::high_resolution_clock::now();
+                PlacedBatch(first, count, h, path, paths, counters, &workspace);
+                auto busy_end = std::chrono::high_resolution_clock::now();
+                workerBusy[ThreadPool::WorkerIndex()] += std::chrono::duration_cast<std::chrono::microseconds>(busy_end - busy_start).count();
+                taskCounters[(first - 1) / batch] = counters;
+                taskHardware[(first - 1) / batch] = scope.Read();
+                workspace.release(); // Johnson may return, and its resource go, right after the count down
+                done.CountDown();
+            });
+        }
+        done.Wait();
+        timer.Mark("dijkstra");
+
+        finish();
+        return path;
     }
 
-    // End time measurement
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-    std::cout << "Execution time (NewGraphRealization): " << duration << " microseconds" << std::endl;
+    // Most expensive sources first, so the last tasks are the short ones
+    std::vector<lng> cost = SourceCosts();
+    std::pmr::vector<lng> order(V, &arena);
+    for (lng i = 0; i < V; i++)
+        order[i] = i + 1;
+    std::stable_sort(order.begin(), order.end(), [&](lng a, lng b) { return cost[a] > cost[b]; });
+
+    /*
+        Every task claims chunks of the order until it is exhausted; a chunk is
+        1 / (2 * workers) of what is left, so chunks shrink towards the cheap tail.
+        A worker may run several of the tasks, busy time goes to the worker's slot.
+    */
+    size_t T = std::max<size_t>(1, pool.Size());
+    std::atomic<size_t> next{ 0 };
+    workerBusy.assign(T, 0);
+    taskCounters.resize(T);
+    taskHardware.resize(T);
+
+    Latch done(T);
+    for (size_t t = 0; t < T; t++) {
+        pool.Submit([&, t] {
+            PerfScope scope;
+            SearchCounters counters;
+            // owned by the worker, the heap of every source reuses the blocks of the previous one
+            std::pmr::unsynchronized_pool_resource workspace(memory);
+            size_t first = next.load();
+            while (first < order.size()) {
+                size_t chunk = std::max<size_t>(1, (order.size() - first) / (2 * T));
+                if (!next.compare_exchange_weak(first, first + chunk))
+                    continue; // first now holds the current cursor
 
+                auto busy_start = std::chrono::high_resolution_clock::now();
+                lng trace_start = Trace::Enabled() ? Trace::Now() : 0;
+                for (size_t k = first; k < first + chunk && k < order.size(); k++)
+                    PlacedRow(order[k], h, path[order[k]], paths[order[k]], counters, &workspace);
+                auto busy_end = std::chrono::high_resolution_clock::now();
+                workerBusy[ThreadPool::WorkerIndex()] += std::chrono::duration_cast<std::chrono::microseconds>(busy_end - busy_start).count();
+                if (Trace::Enabled())
+                    Trace::Complete("sources", trace_start, Trace::Now(), chunk);
+
+                first = next.load();
+            }
+            taskCounters[t] = counters;
+            taskHardware[t] = scope.Read();
+            workspace.release(); // Johnson may return, and its resource go, right after the count down
+            done.CountDown();
+        });
+    }
+    done.Wait();
+    timer.Mark("dijkstra");
+
+    finish();
     return path;
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Size of the reduced adjacency in use
+/// </summary>
+lng GraphMT::ReducedBytes() const
+{
+    lng arcs = reducedWidth == 16 ? reduced16.Arcs() : reducedWidth == 32 ? reduced32.Arcs() : reduced64.Arcs();
+    return (V + 2) * sizeof(lng) + arcs * (sizeof(lng) + reducedWidth / 8);
+}
+
+/// <summary>
+/// Gives a result row its V + 1 entries. The row is reserved first, so huge page
+/// advice reaches its pages before they are touched.
+/// </summary>
+void GraphMT::PlaceRow(std::vector<lng>& row)
+{
+    row.reserve(V + 1);
+    if (Placement::HugePagesEnabled() && row.empty())
+        Placement::AdviseHugePages(row.data(), (V + 1) * sizeof(lng));
+    row.resize(V + 1);
+}
+
+/// <summary>
+/// ReducedRow for one source of a worker: allocates the rows of the source if the
+/// workers own them, and searches the copy of the reduced adjacency of the worker's node
+/// </summary>
+void GraphMT::PlacedRow(lng src, const std::vector<lng>& h, std::vector<lng>& dist, std::vector<lng>& parent,
+    SearchCounters& counters, std::pmr::memory_resource* workspace)
+{
+    if (dist.empty()) {
+        PlaceRow(dist);
+        PlaceRow(parent);
+    }
+    ReducedReplica* replica = NodeReplica();
+    if (!replica)
+        ReducedRow(src, h, dist, parent, counters, workspace);
+    else if (reducedWidth == 16)
+        ReducedRow(replica->reduced16, src, h, dist, parent, counters, workspace);
+    else if (reducedWidth == 32)
+        ReducedRow(replica->reduced32, src, h, dist, parent, counters, workspace);
+    else
+        ReducedRow(replica->reduced64, src, h, dist, parent, counters, workspace);
+}
+
+/// <summary>
+/// BatchedDijkstra for the sources first .. first + count - 1 of a worker, placed like PlacedRow
+/// </summary>
+void GraphMT::PlacedBatch(lng first, lng count, const std::vector<lng>& h, std::vector<std::vector<lng>>& path,
+    std::vector<std::vector<lng>>& paths, SearchCounters& counters, std::pmr::memory_resource* workspace)
+{
+    for (lng src = first; src < first + count; src++) {
+        if (path[src].empty()) {
+            PlaceRow(path[src]);
+            PlaceRow(paths[src]);
+        }
+    }
+    ReducedReplica* replica = NodeReplica();
+    if (!replica)
+        BatchedDijkstra(first, count, h, path, paths, counters, workspace);
+    else if (reducedWidth == 16)
+        BatchedDijkstra(replica->reduced16, first, count, h, path, paths, counters, workspace);
+    else if (reducedWidth == 32)
+        BatchedDijkstra(replica->reduced32, first, count, h, path, paths, counters, workspace);
+    else
+        BatchedDijkstra(replica->reduced64, first, count, h, path, paths, counters, workspace);
+}
+
+/// <summary>
+/// Copy of the reduced adjacency on the calling worker's node, made by its first reader
+/// </summary>
+/// <returns>Null if the adjacency is not replicated</returns>
+GraphMT::ReducedReplica* GraphMT::NodeReplica()
+{
+    if (replicas.empty())
+        return nullptr;
+
+    ReducedReplica& replica = *replicas[Placement::CurrentNode() % replicas.size()];
+    std::call_once(replica.copied, [&] {
+        if (reducedWidth == 16)
+            replica.reduced16 = reduced16;
+        else if (reducedWidth == 32)
+            replica.reduced32 = reduced32;
+        else
+            replica.reduced64 = reduced64;
+    });
+    return &replica;
+}
+
+/// <summary>
+/// Checks h[v] &lt;= h[u] + w(u, v) for every arc of adj_list on the pool. The reduced weights
+/// of a cycle sum up to its weight, so a negative cycle always has a violated arc.
+/// </summary>
+/// <param name="h">Potentials of the vertices</param>
+/// <returns>True if all reduced weights are non-negative</returns>
+bool GraphMT::FeasiblePotentials(const std::vector<lng>& h)
+{
+    std::atomic<bool> feasible{ true };
+    ParallelFor(1, V + 1, [&](lng begin, lng end, lng) {
+        for (lng u = begin; u < end && feasible.load(std::memory_order_relaxed); u++) {
+            for (const auto& arc : adj_list[u]) {
+                if (h[arc.first] > h[u] + arc.second) {
+                    feasible = false;
+                    break;
+                }
+            }
+        }
+    });
+    return feasible;
+}
+
+/// <summary>
+/// Estimated work of a Dijkstra from every vertex: the vertices and edges it can reach.
+/// Every vertex of a component reaches the same set, summed over the condensation DAG
+/// in reverse topological order (shared descendants are counted once per path, so the
+/// estimate is capped by the size of the graph).
+/// </summary>
+/// <returns>Estimated cost, indexed by vertex</returns>
+std::vector<lng> GraphMT::SourceCosts()
+{
+    Condensation scc(adj_list, V);
+    lng C = scc.ComponentCount();
+
+    std::vector<lng> estimate(C, 0);
+    lng total = 0;
+    for (lng c = 0; c < C; c++) {
+        for (lng v : scc.Members(c))
+            estimate[c] += 1 + adj_list[v].size();
+        total += estimate[c];
+    }
+
+    // successors have higher ids, so they are final when c is reached
+    for (lng c = C - 1; c >= 0; c--) {
+        for (lng s : scc.Successors(c))
+            estimate[c] = std::min(total, estimate[c] + estimate[s]);
+    }
+
+    std::vector<lng> cost(V + 1, 0);
+    for (lng v = 1; v <= V; v++)
+        cost[v] = estimate[scc.Component(v)];
+    return cost;
+}
+
+/// <summary>
+/// Johnson's algorithm over the condensation DAG with multithreading,
+/// every strongly connected component is one task
+/// </summary>
+/// <returns>Distances and parents of the reachable pairs</returns>
+SparseDistances GraphMT::JohnsonSparse() {
+    Condensation scc(adj_list, V);
+
+    std::vector<char> negative;
+    std::vector<lng> h = CondensedBellmanFord(scc, negative);
+
+    SparseDistances result = PrepareSparse(scc, negative);
+
+    std::vector<lng> blocks;
+    for (lng c = 0; c < scc.ComponentCount(); c++)
+        if (!result.undefined[scc.Members(c).front()])
+            blocks.push_back(c);
+
+    Latch done(blocks.size());
+    for (lng c : blocks) {
+        pool.Submit([&, c] {
+            SparseBlock(c, scc, h, result);
+            done.CountDown();
+        });
+    }
+    done.Wait();
+
+    return result;
+}
+
+/// <summary>
+/// Shortest paths from the given sources. With fewer sources than workers a single
+/// Dijkstra would leave the pool idle, so every source runs the parallel DeltaStepping;
+/// otherwise the sources are spread over the pool.
+/// </summary>
+/// <param name="sources">Requested sources</param>
+/// <param name="parents">Receives the parents of every source, aligned with sources</param>
+/// <param name="delta">Bucket width of DeltaStepping, 0 chooses it from the weights</param>
+/// <returns>Distances(weight) aligned with sources, empty if the graph has a negative cycle</returns>
+std::vector<std::vector<lng>> GraphMT::ShortestPathsFrom(const std::vector<lng>& sources,
+    std::vector<std::vector<lng>>& parents, lng delta)
+{
+    if (HasNegativeCycle()) {
+        return std::vector<std::vector<lng>>(); // return empty vector
+    }
+
+    std::vector<std::vector<lng>> dist(sources.size());
+    parents.assign(sources.size(), std::vector<lng>());
+
+    if (sources.size() < pool.Size()) {
+        for (size_t i = 0; i < sources.size(); i++)
+            dist[i] = DeltaStepping(sources[i], parents[i], delta);
+        return dist;
+    }
+
+    std::vector<std::future<std::vector<lng>>> futures;
+    for (size_t i = 0; i < sources.size(); i++)
+        futures.emplace_back(pool.Enqueue(&GraphMT::ReducedDijkstra, this, sources[i], std::cref(potentials), std::ref(parents[i])));
+    for (size_t i = 0; i < sources.size(); i++)
+        dist[i] = futures[i].get();
+    return dist;
+}
+
+/// <summary>
+/// Delta-stepping (Meyer, Sanders) on the reduced weights, one source on all workers.
+/// Bucket i holds the vertices with tentative distance in [i * delta, (i + 1) * delta).
+/// Light edges (weight &lt;= delta) are relaxed until the bucket stays empty, then the
+/// heavy edges of every vertex removed from it once. In each round the workers first
+/// generate relaxation requests for their share of the frontier, then every worker
+/// applies the requests of the vertices it owns (v % workers), so no atomics are needed.
+/// Must not be called from a task of the pool.
+/// </summary>
+/// <param name="src">Source vertex</param>
+/// <param name="parent">Receives the parent of every vertex on its shortest path</param>
+/// <param name="delta">Bucket width, 0 chooses the mean reduced weight</param>
+/// <returns>Distance(weight) of the shortest path, empty if the graph has a negative cycle</returns>
+std::vector<lng> GraphMT::DeltaStepping(lng src, std::vector<lng>& parent, lng delta)
+{
+    if (HasNegativeCycle())
+        return std::vector<lng>();
+    const std::vector<lng>& h = Potentials();
+
+    if (delta <= 0) {
+        lng total = 0, count = 0;
+        for (lng u = 1; u <= V; u++) {
+            for (const auto& arc : adj_list[u]) {
+                total += arc.second + h[u] - h[arc.first];
+                count++;
+            }
+        }
+        delta = std::max<lng>(1, count ? total / count : 1);
+    }
+
+    lng maxLight = 0;
+    for (lng u = 1; u <= V; u++) {
+        for (const auto& arc : adj_list[u]) {
+            lng w = arc.second + h[u] - h[arc.first];
+            if (w <= delta)
+                maxLight = std::max(maxLight, w);
+        }
+    }
+
+    std::vector<lng> dist(V + 1, LLONG_MAX);
+    parent.assign(V + 1, -1);
+    dist[src] = 0;
+    parent[src] = src;
+
+    struct Request {
+        lng to, dist, from;
+    };
+    size_t T = std::max<size_t>(1, pool.Size());
+    std::vector<std::vector<std::vector<Request>>> requests(T, std::vector<std::vector<Request>>(T));
+    std::vector<std::vector<lng>> improved(T);
+    std::vector<char> queued(V + 1, 0);
+
+    /*
+        Light edges reach at most maxLight past the current bucket, so the buckets
+        i .. i + slots - 1 are the slots of a cyclic array (bucket b in slot b % slots);
+        heavy edges may go further, those buckets wait in an ordered map until the
+        window reaches them. An entry is current only if its vertex still has that bucket.
+    */
+    lng slots = (maxLight + delta - 1) / delta + 1;
+    std::vector<std::vector<lng>> buckets(slots);
+    std::map<lng, std::vector<lng>> far;
+    buckets[0].push_back(src);
+    lng i = 0;
+
+    // runs body(t) for every worker t and waits for all of them
+    auto parallel = [&](const std::function<void(size_t)>& body) {
+        Latch done(T);
+        for (size_t t = 0; t < T; t++) {
+            pool.Submit([&, t] {
+                body(t);
+                done.CountDown();
+            });
+        }
+        done.Wait();
+    };
+
+    auto relax = [&](const std::vector<lng>& frontier, bool light) {
+        if (frontier.empty())
+            return;
+        parallel([&](size_t t) {
+            lng scanned = 0;
+            for (size_t k = t; k < frontier.size(); k += T) {
+                lng u = frontier[k];
+                for (const auto& arc : adj_list[u]) {
+                    lng w = arc.second + h[u] - h[arc.first];
+                    if ((w <= delta) != light)
+                        continue;
+                    scanned++;
+                    requests[t][arc.first % T].push_back({ arc.first, dist[u] + w, u });
+                }
+            }
+            relaxations += scanned;
+        });
+        parallel([&](size_t owner) {
+            for (size_t t = 0; t < T; t++) {
+                for (const Request& request : requests[t][owner]) {
+                    if (request.dist < dist[request.to]) {
+                        dist[request.to] = request.dist;
+                        parent[request.to] = request.from;
+                        improved[owner].push_back(request.to);
+                    }
+                }
+                requests[t][owner].clear();
+            }
+        });
+
+        for (auto& list : improved) {
+            for (lng v : list) {
+                lng b = dist[v] / delta;
+                if (b < i + slots)
+                    buckets[b % slots].push_back(v);
+                else
+                    far[b].push_back(v);
+            }
+            list.clear();
+        }
+    };
+
+    while (true) {
+        std::vector<lng>& bucket = buckets[i % slots];
+        std::vector<lng> removed;
+        while (!bucket.empty()) {
+            // entries of vertices that moved to a lower bucket are outdated
+            std::vector<lng> frontier;
+            for (lng v : bucket) {
+                if (!queued[v] && dist[v] / delta == i) {
+                    queued[v] = 1;
+                    frontier.push_back(v);
+                }
+            }
+            bucket.clear();
+            for (lng v : frontier)
+                queued[v] = 0;
+
+            removed.insert(removed.end(), frontier.begin(), frontier.end());
+            relax(frontier, true);
+        }
+
+        // a vertex may leave the bucket several times, its heavy edges are relaxed once
+        std::vector<lng> settled;
+        for (lng v : removed) {
+            if (!queued[v]) {
+                queued[v] = 1;
+                settled.push_back(v);
+            }
+        }
+        for (lng v : settled)
+            queued[v] = 0;
+        relax(settled, false);
+
+        // empty buckets are skipped, not visited
+        lng step = 1;
+        while (step < slots && buckets[(i + step) % slots].empty())
+            step++;
+        if (step < slots)
+            i += step;
+        else if (!far.empty())
+            i = far.begin()->first;
+        else
+            break;
+        while (!far.empty() && far.begin()->first < i + slots) {
+            std::vector<lng>& slot = buckets[far.begin()->first % slots];
+            slot.insert(slot.end(), far.begin()->second.begin(), far.begin()->second.end());
+            far.erase(far.begin());
+        }
+    }
+
+    for (lng v = 1; v <= V; v++)
+        if (dist[v] != LLONG_MAX)
+            dist[v] += h[v] - h[src];
+
+    return dist;
+}
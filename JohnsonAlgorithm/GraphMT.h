@@ -3,6 +3,8 @@
 #include <thread>
 #include <future>
 #include <mutex>
+#include "Csr.h"
+#include "Placement.h"
 #include "Graph.h"
 #include "ThreadPool.h"
 
@@ -13,10 +15,80 @@ class GraphMT : public Graph
 {
 private:
     ThreadPool pool; // Thread pool object
+    size_t batch; // sources per BatchedDijkstra task, 1 runs one Dijkstra per task
+    PlacementOptions placement;
+
+    /// <summary>
+    /// Microseconds every worker spent in Dijkstra during the last Johnson run
+    /// </summary>
+    std::vector<lng> workerBusy;
+
+    /// <summary>
+    /// Copy of the reduced adjacency for one NUMA node, made by the first worker
+    /// that runs there, so its pages are on that node
+    /// </summary>
+    struct ReducedReplica {
+        Csr<uint16_t> reduced16;
+        Csr<uint32_t> reduced32;
+        Csr<lng> reduced64;
+        std::once_flag copied;
+    };
+    std::vector<std::unique_ptr<ReducedReplica>> replicas;
+
+    std::vector<lng> SourceCosts();
+
+    lng ReducedBytes() const;
+
+    void PlaceRow(std::vector<lng>& row);
+
+    void PlacedRow(lng src, const std::vector<lng>& h, std::vector<lng>& dist, std::vector<lng>& parent,
+        SearchCounters& counters, std::pmr::memory_resource* workspace);
+
+    void PlacedBatch(lng first, lng count, const std::vector<lng>& h, std::vector<std::vector<lng>>& path,
+        std::vector<std::vector<lng>>& paths, SearchCounters& counters, std::pmr::memory_resource* workspace);
+
+    ReducedReplica* NodeReplica();
+
+    bool FeasiblePotentials(const std::vector<lng>& h);
+
+    /// <summary>
+    /// Splits [first, last) into one range per worker and runs body(begin, end, range)
+    /// on each of them, returns when all ranges are done. The split depends only on
+    /// the bounds, so two calls over the same bounds see the same ranges.
+    /// </summary>
+    template <class F>
+    void ParallelFor(lng first, lng last, F body)
+    {
+        if (first >= last)
+            return;
+        lng T = std::max<lng>(1, pool.Size());
+        lng step = (last - first + T - 1) / T;
+        Latch done((last - first + step - 1) / step);
+        for (lng begin = first, range = 0; begin < last; begin += step, range++) {
+            lng end = std::min(last, begin + step);
+            pool.Submit([&, begin, end, range] {
+                body(begin, end, range);
+                done.CountDown();
+            });
+        }
+        done.Wait();
+    }
 
 public:
-    GraphMT(std::vector<Edge>& edges, lng V, size_t num_threads)
-        : Graph(edges, V), pool(num_threads) {}
+    GraphMT(std::vector<Edge>& edges, lng V, size_t num_threads, size_t batch = 1,
+        PlacementOptions placement = PlacementOptions())
+        : Graph(edges, V), pool(num_threads, placement.pinWorkers), batch(batch), placement(placement) {}
 
     std::vector<std::vector<lng>> Johnson(lng E, std::vector<std::vector<lng>>& paths) override;
+
+    SparseDistances JohnsonSparse() override;
+
+    std::vector<std::vector<lng>> ShortestPathsFrom(const std::vector<lng>& sources,
+        std::vector<std::vector<lng>>& parents, lng delta = 0);
+
+    std::vector<lng> DeltaStepping(lng src, std::vector<lng>& parent, lng delta = 0);
+
+    const std::vector<lng>& WorkerBusyTime() const { return workerBusy; }
+
+    ThreadPoolMetrics PoolMetrics() { return pool.Metrics(); }
 };
\ No newline at end of file
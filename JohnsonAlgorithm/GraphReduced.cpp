@@ -0,0 +1,230 @@
+#include "GraphReduced.h"
+
+#include "GraphMT.h"
+
+/// <summary>
+/// Johnson's algorithm on the kernel left by Reduce. The kernel result is expanded
+/// to the full matrices, the callers index distances and parents by input vertex.
+/// </summary>
+/// <param name="E">Number of edges</param>
+/// <param name="paths">Pathes from each vertex to each vertex</param>
+/// <returns>Distances(weight) of the shortest paths</returns>
+std::vector<std::vector<lng>> GraphReduced::Johnson(lng /*E*/, std::vector<std::vector<lng>>& paths)
+{
+    // lightest edge between every pair, both directions
+    std::vector<std::map<lng, lng>> out(V + 1), in(V + 1);
+    for (lng u = 1; u <= V; u++) {
+        for (const auto& arc : adj_list[u]) {
+            auto it = out[u].find(arc.first);
+            if (it == out[u].end() || arc.second < it->second)
+                out[u][arc.first] = in[arc.first][u] = arc.second;
+        }
+    }
+
+    std::vector<Removal> removals;
+    if (!Reduce(out, in, removals)) {
+        return std::vector<std::vector<lng>>(); // return empty vector
+    }
+
+    // kernel with compact ids
+    std::vector<char> removed(V + 1, 0);
+    for (const Removal& removal : removals)
+        removed[removal.x] = 1;
+    std::vector<lng> kernelId(V + 1, 0), originalId(1, 0);
+    for (lng v = 1; v <= V; v++) {
+        if (!removed[v]) {
+            kernelId[v] = originalId.size();
+            originalId.push_back(v);
+        }
+    }
+    std::vector<Edge> kernel;
+    for (lng v = 1; v <= V; v++)
+        for (const auto& arc : out[v])
+            kernel.push_back({ kernelId[v], kernelId[arc.first], arc.second });
+
+    kernelVertices = originalId.size() - 1;
+    kernelEdges = kernel.size();
+
+    /*
+        2D matrix to store all-pairs shortest path
+        path[u][v] = shortest path from u to v
+    */
+    std::vector<std::vector<lng>> path(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+    paths.assign(V + 1, std::vector<lng>());
+    for (lng v = 1; v <= V; v++) {
+        paths[v].assign(V + 1, -1);
+        paths[v][v] = v;
+        path[v][v] = 0;
+    }
+
+    if (kernelVertices > 0) {
+        GraphMT kernelGraph(kernel, kernelVertices, num_threads);
+        std::vector<std::vector<lng>> kernelPaths(kernelVertices + 1);
+        std::vector<std::vector<lng>> kernelPath = kernelGraph.Johnson(kernelEdges, kernelPaths);
+        relaxations += kernelGraph.Relaxations();
+
+        if (kernelPath.empty()) {
+            return std::vector<std::vector<lng>>(); // return empty vector
+        }
+
+        for (lng i = 1; i <= kernelVertices; i++) {
+            for (lng j = 1; j <= kernelVertices; j++) {
+                path[originalId[i]][originalId[j]] = kernelPath[i][j];
+                if (kernelPaths[i][j] > 0)
+                    paths[originalId[i]][originalId[j]] = originalId[kernelPaths[i][j]];
+            }
+        }
+    }
+
+    // the last removed vertex attaches to a graph that is already complete
+    for (auto it = removals.rbegin(); it != removals.rend(); ++it)
+        Restore(*it, path, paths);
+
+    return path;
+}
+
+/// <summary>
+/// Removes vertices with at most two distinct neighbours until none is left.
+/// A degree 2 vertex x between a and b is replaced by the shortcuts a -> b and b -> a
+/// when the paths a -> x -> b and b -> x -> a exist.
+/// </summary>
+/// <param name="out">Lightest outgoing edges, updated in place</param>
+/// <param name="in">Lightest incoming edges, updated in place</param>
+/// <param name="removals">Removed vertices in removal order</param>
+/// <returns>False if a removed vertex lies on a cycle with negative weight</returns>
+bool GraphReduced::Reduce(std::vector<std::map<lng, lng>>& out, std::vector<std::map<lng, lng>>& in,
+    std::vector<Removal>& removals)
+{
+    std::vector<char> removed(V + 1, 0), pinned(V + 1, 0);
+    for (lng v = 1; v <= V; v++)
+        pinned[v] = out[v].count(v) > 0; // a self-loop is left to the kernel
+
+    auto neighbours = [&](lng v) {
+        std::vector<lng> result;
+        for (const auto& arc : out[v])
+            result.push_back(arc.first);
+        for (const auto& arc : in[v])
+            if (!out[v].count(arc.first))
+                result.push_back(arc.first);
+        return result;
+    };
+    auto weight = [](const std::map<lng, lng>& arcs, lng v) {
+        auto it = arcs.find(v);
+        return it == arcs.end() ? LLONG_MAX : it->second;
+    };
+
+    std::vector<lng> todo;
+    for (lng v = V; v >= 1; v--)
+        todo.push_back(v);
+
+    while (!todo.empty()) {
+        lng x = todo.back();
+        todo.pop_back();
+        if (removed[x] || pinned[x])
+            continue;
+        std::vector<lng> adjacent = neighbours(x);
+        if (adjacent.size() > 2)
+            continue;
+
+        Removal removal = { x, 0, 0, LLONG_MAX, LLONG_MAX, LLONG_MAX, LLONG_MAX, false, false };
+        if (adjacent.size() > 0) {
+            removal.a = adjacent[0];
+            removal.inA = weight(in[x], removal.a);
+            removal.outA = weight(out[x], removal.a);
+            if (removal.inA != LLONG_MAX && removal.outA != LLONG_MAX && removal.inA + removal.outA < 0)
+                return false;
+        }
+        if (adjacent.size() > 1) {
+            removal.b = adjacent[1];
+            removal.inB = weight(in[x], removal.b);
+            removal.outB = weight(out[x], removal.b);
+            if (removal.inB != LLONG_MAX && removal.outB != LLONG_MAX && removal.inB + removal.outB < 0)
+                return false;
+        }
+
+        for (const auto& arc : in[x])
+            out[arc.first].erase(x);
+        for (const auto& arc : out[x])
+            in[arc.first].erase(x);
+        in[x].clear();
+        out[x].clear();
+
+        if (adjacent.size() == 2) {
+            lng a = removal.a, b = removal.b;
+            if (removal.inA != LLONG_MAX && removal.outB != LLONG_MAX && removal.inA + removal.outB < weight(out[a], b)) {
+                out[a][b] = in[b][a] = removal.inA + removal.outB;
+                removal.viaAB = true;
+            }
+            if (removal.inB != LLONG_MAX && removal.outA != LLONG_MAX && removal.inB + removal.outA < weight(out[b], a)) {
+                out[b][a] = in[a][b] = removal.inB + removal.outA;
+                removal.viaBA = true;
+            }
+        }
+
+        removed[x] = 1;
+        removals.push_back(removal);
+        for (lng v : adjacent)
+            todo.push_back(v);
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Adds the row and the column of a removed vertex. Without negative cycles a shortest
+/// path never enters and leaves x through the same neighbour, so
+/// path[s][x] = min(path[s][a] + w(a, x), path[s][b] + w(b, x)) and symmetrically for path[x][t].
+/// </summary>
+/// <param name="removal">Removed vertex with its attachment</param>
+/// <param name="path">Distances of the vertices restored so far</param>
+/// <param name="paths">Pathes of the vertices restored so far</param>
+void GraphReduced::Restore(const Removal& removal, std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths)
+{
+    lng x = removal.x, a = removal.a, b = removal.b;
+
+    // shortest paths that used a shortcut continue through x
+    for (lng s = 1; s <= V; s++) {
+        if (removal.viaAB && paths[s][b] == a)
+            paths[s][b] = x;
+        if (removal.viaBA && paths[s][a] == b)
+            paths[s][a] = x;
+    }
+
+    auto join = [](lng first, lng second) {
+        return (first == LLONG_MAX || second == LLONG_MAX) ? LLONG_MAX : first + second;
+    };
+
+    // column x: the last edge comes from a or b, not from a neighbour reached through x
+    for (lng s = 1; s <= V; s++) {
+        if (s == x)
+            continue;
+        lng viaA = (a && paths[s][a] != x) ? join(path[s][a], removal.inA) : LLONG_MAX;
+        lng viaB = (b && paths[s][b] != x) ? join(path[s][b], removal.inB) : LLONG_MAX;
+        if (viaA != LLONG_MAX && viaA <= viaB) {
+            path[s][x] = viaA;
+            paths[s][x] = a;
+        }
+        else if (viaB != LLONG_MAX) {
+            path[s][x] = viaB;
+            paths[s][x] = b;
+        }
+    }
+
+    // row x: the first edge goes to a or b, the rest is the tree of that neighbour
+    for (lng t = 1; t <= V; t++) {
+        if (t == x)
+            continue;
+        lng viaA = a ? join(removal.outA, path[a][t]) : LLONG_MAX;
+        lng viaB = b ? join(removal.outB, path[b][t]) : LLONG_MAX;
+        lng next = 0;
+        if (viaA != LLONG_MAX && viaA <= viaB)
+            next = a;
+        else if (viaB != LLONG_MAX)
+            next = b;
+        if (!next)
+            continue;
+
+        path[x][t] = next == a ? viaA : viaB;
+        paths[x][t] = (t == next) ? x : paths[next][t];
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include "Graph.h"
+
+/// <summary>
+/// Realization of graph that removes degree 0/1 vertices and contracts degree 2 vertices
+/// into shortcuts, runs the multithreaded Johnson on the remaining kernel and
+/// reconstructs the removed vertices from their attachment points.
+/// The reduction saves search time only: Johnson still returns the dense (V + 1)^2
+/// matrices of every engine, rows and columns of the removed vertices included.
+/// </summary>
+class GraphReduced : public Graph {
+public:
+    GraphReduced(std::vector<Edge>& edges, lng V, size_t num_threads)
+        : Graph(edges, V), num_threads(num_threads), kernelVertices(0), kernelEdges(0) {}
+
+    std::vector<std::vector<lng>> Johnson(lng E, std::vector<std::vector<lng>>& paths) override;
+
+    /// <summary>
+    /// Size of the kernel of the last Johnson run
+    /// </summary>
+    lng KernelVertices() const { return kernelVertices; }
+    lng KernelEdges() const { return kernelEdges; }
+
+private:
+    /// <summary>
+    /// Vertex x removed with its neighbours a and b (0 if absent) and the weights
+    /// of a -> x, x -> a, b -> x, x -> b (LLONG_MAX if absent).
+    /// viaAB / viaBA: the shortcut a -> x -> b / b -> x -> a replaced the edge between a and b.
+    /// </summary>
+    struct Removal {
+        lng x, a, b;
+        lng inA, outA, inB, outB;
+        bool viaAB, viaBA;
+    };
+
+    size_t num_threads;
+    lng kernelVertices;
+    lng kernelEdges;
+
+    bool Reduce(std::vector<std::map<lng, lng>>& out, std::vector<std::map<lng, lng>>& in,
+        std::vector<Removal>& removals);
+
+    void Restore(const Removal& removal, std::vector<std::vector<lng>>& path, std::vector<std::vector<lng>>& paths);
+};
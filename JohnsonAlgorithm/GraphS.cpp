@@ -6,48 +6,66 @@
 /// <param name="E">Number of edges</param>
 /// <param name="paths">Pathes from each vertex to each vertex</param>
 /// <returns>Distances(weight) of the shortest paths</returns>
-std::vector<std::vector<lng>> GraphS::Johnson(lng E, std::vector<std::vector<lng>>& paths) 
+std::vector<std::vector<lng>> GraphS::Johnson(lng /*E*/, std::vector<std::vector<lng>>& paths) 
 {
-    // Start time measurement
-    auto start_time = std::chrono::high_resolution_clock::now();
+    stats = JohnsonStats();
+    PhaseTimer timer(stats);
+    timer.Record("load", loadMicroseconds);
+    SearchCounters counters;
 
-    // the shortest distance values are values of h[]
-    std::vector<lng> h = BellmanFord(V, edges);
-
-    // Check for negative weight cycle
-    for (const Edge& edge : edges) 
+    // No cycles, so no negative cycles either: relax in topological order without potentials
+    if (acyclic)
     {
-        if (h[edge.from] != LLONG_MAX && h[edge.to] > h[edge.from] + edge.weight) 
-        {
-            std::cout << "The graph contains a cycle with negative weight." << std::endl;
-            return std::vector<std::vector<lng>>(); // return empty vector
-        }
+        std::vector<std::vector<lng>> path(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+        for (int i = 1; i <= V; i++)
+            paths[i].resize(V + 1);
+        timer.Mark("output");
+
+        for (int i = 1; i <= V; i++)
+            DagShortestPaths(i, path[i], paths[i], counters);
+        timer.Mark("dijkstra");
+        stats.counters = counters;
+        FinishStats();
+
+        return path;
     }
 
-    // Update edge weights
-    for (int i = 0; i < E; i++) 
+    // the shortest distance values are values of h[], kept by the graph between runs
+    const std::vector<lng>& h = Potentials();
+    timer.Mark("bellman-ford");
+
+    // Check for negative weight cycle
+    if (HasNegativeCycle())
     {
-        lng u = edges[i].from;
-        lng v = edges[i].to;
-        edges[i].weight += (h[u] - h[v]);
+        return std::vector<std::vector<lng>>(); // return empty vector
     }
+    timer.Mark("cycle check");
+
+    // Dijkstra reads the reduced weights from their own adjacency, the graph keeps the original ones
+    BuildReduced(h);
+    timer.Mark("reweight");
 
     /*
         2D matrix to store all-pairs shortest path
         path[u][v] = shortest path from u to v
     */
     std::vector<std::vector<lng>> path(V + 1, std::vector<lng>(V + 1, LLONG_MAX));
+    for (int i = 1; i <= V; i++)
+        paths[i].resize(V + 1);
+    timer.Mark("output");
 
     /*
     Step 4 - Remove the added vertex (vertex 0) and apply Dijkstra's algorithm for every vertex.
     */
-    for (int i = 1; i <= V; i++)
-        path[i] = Dijkstra(i, adj_list, V, paths);
-
-    // End time measurement
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-    std::cout << "Execution time (OldGraphRealization): " << duration << " microseconds" << std::endl;
+    {
+        // the heap of every source reuses the blocks of the previous one
+        std::pmr::unsynchronized_pool_resource workspace(memory);
+        for (int i = 1; i <= V; i++)
+            ReducedRow(i, h, path[i], paths[i], counters, &workspace);
+    }
+    timer.Mark("dijkstra");
+    stats.counters = counters;
+    FinishStats();
 
     return path;
 }
\ No newline at end of file
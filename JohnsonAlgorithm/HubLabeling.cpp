@@ -0,0 +1,266 @@
+#include "HubLabeling.h"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HUB_LABELING_SSE2
+#endif
+
+/// <summary>
+/// Builds the labels. The hubs depend on each other and go one by one, only the
+/// forward and backward searches of a hub are independent, so at most two threads help.
+/// </summary>
+/// <param name="edges">Vector of edges with non-negative weights</param>
+/// <param name="V">Number of vertices</param>
+/// <param name="parallel">Runs the forward search of every hub on a worker thread while the
+/// calling thread runs the backward one</param>
+HubLabeling::HubLabeling(const std::vector<Edge>& edges, lng V, bool parallel) : V(V)
+{
+    // forward and reverse adjacency in CSR form
+    std::vector<lng> fwdOffset(V + 2, 0), bwdOffset(V + 2, 0);
+    for (const Edge& edge : edges) {
+        if (edge.weight < 0)
+            throw std::invalid_argument("hub labeling requires non-negative weights");
+        fwdOffset[edge.from + 1]++;
+        bwdOffset[edge.to + 1]++;
+    }
+    for (lng v = 0; v <= V; v++) {
+        fwdOffset[v + 1] += fwdOffset[v];
+        bwdOffset[v + 1] += bwdOffset[v];
+    }
+    std::vector<std::pair<lng, lng>> fwdArcs(edges.size()), bwdArcs(edges.size());
+    {
+        std::vector<lng> fwdPos(fwdOffset.begin(), fwdOffset.end() - 1), bwdPos(bwdOffset.begin(), bwdOffset.end() - 1);
+        for (const Edge& edge : edges) {
+            fwdArcs[fwdPos[edge.from]++] = { edge.to, edge.weight };
+            bwdArcs[bwdPos[edge.to]++] = { edge.from, edge.weight };
+        }
+    }
+
+    // hubs by decreasing degree, high-degree vertices cover most shortest paths
+    order.resize(V);
+    for (lng v = 1; v <= V; v++)
+        order[v - 1] = v;
+    std::stable_sort(order.begin(), order.end(), [&](lng a, lng b) {
+        return fwdOffset[a + 1] - fwdOffset[a] + bwdOffset[a + 1] - bwdOffset[a]
+            > fwdOffset[b + 1] - fwdOffset[b] + bwdOffset[b + 1] - bwdOffset[b];
+    });
+
+    std::vector<std::vector<std::pair<int, lng>>> outLabels(V + 1), inLabels(V + 1);
+
+    // per-direction scratch, the two searches of one hub never share data
+    std::vector<lng> fwdDist(V + 1, LLONG_MAX), bwdDist(V + 1, LLONG_MAX);
+    std::vector<lng> fwdTouched, bwdTouched;
+    std::vector<lng> rootOut(V, LLONG_MAX), rootIn(V, LLONG_MAX);
+
+    std::unique_ptr<ThreadPool> pool;
+    if (parallel)
+        pool.reset(new ThreadPool(1));
+
+    for (int rank = 0; rank < V; rank++) {
+        lng root = order[rank];
+
+        /*
+            The forward search writes only in-labels and reads the root's out-label,
+            the backward search writes only out-labels and reads the root's in-label.
+            Both root labels are copied before the searches start, so they can run
+            concurrently.
+        */
+        for (const auto& entry : outLabels[root])
+            rootOut[entry.first] = entry.second;
+        for (const auto& entry : inLabels[root])
+            rootIn[entry.first] = entry.second;
+
+        if (pool) {
+            Latch forward(1);
+            pool->Submit([&, rank] {
+                PrunedDijkstra(rank, fwdOffset, fwdArcs, rootOut, inLabels, fwdDist, fwdTouched);
+                forward.CountDown();
+            });
+            PrunedDijkstra(rank, bwdOffset, bwdArcs, rootIn, outLabels, bwdDist, bwdTouched);
+            forward.Wait();
+        }
+        else {
+            PrunedDijkstra(rank, fwdOffset, fwdArcs, rootOut, inLabels, fwdDist, fwdTouched);
+            PrunedDijkstra(rank, bwdOffset, bwdArcs, rootIn, outLabels, bwdDist, bwdTouched);
+        }
+
+        for (const auto& entry : outLabels[root])
+            rootOut[entry.first] = LLONG_MAX;
+        for (const auto& entry : inLabels[root])
+            rootIn[entry.first] = LLONG_MAX;
+    }
+
+    // pack labels into contiguous arrays, already sorted since hubs are added by rank
+    auto pack = [V](std::vector<std::vector<std::pair<int, lng>>>& labels, std::vector<lng>& offset,
+        std::vector<int>& hubs, std::vector<lng>& dist) {
+        offset.assign(V + 2, 0);
+        for (lng v = 0; v <= V; v++)
+            offset[v + 1] = offset[v] + (labels[v].size() / 4 + 1) * 4;
+        hubs.assign(offset[V + 1], INT_MAX);
+        dist.assign(offset[V + 1], LLONG_MAX);
+        for (lng v = 0; v <= V; v++) {
+            for (size_t i = 0; i < labels[v].size(); i++) {
+                hubs[offset[v] + i] = labels[v][i].first;
+                dist[offset[v] + i] = labels[v][i].second;
+            }
+            std::vector<std::pair<int, lng>>().swap(labels[v]);
+        }
+    };
+    if (pool) {
+        auto outPacked = pool->Enqueue([&] { pack(outLabels, outOffset, outHubs, outDist); });
+        pack(inLabels, inOffset, inHubs, inDist);
+        outPacked.get();
+    }
+    else {
+        pack(outLabels, outOffset, outHubs, outDist);
+        pack(inLabels, inOffset, inHubs, inDist);
+    }
+}
+
+/// <summary>
+/// Dijkstra from the hub of the given rank, pruned at vertices already covered by the labels
+/// </summary>
+/// <param name="rank">Rank of the hub</param>
+/// <param name="offset">CSR offsets of the searched direction</param>
+/// <param name="arcs">CSR arcs of the searched direction</param>
+/// <param name="rootLabel">Opposite label of the hub, indexed by hub rank</param>
+/// <param name="labels">Labels filled by this search</param>
+/// <param name="dist">Scratch distances, left filled with LLONG_MAX</param>
+/// <param name="touched">Scratch list of reached vertices</param>
+void HubLabeling::PrunedDijkstra(int rank, const std::vector<lng>& offset, const std::vector<std::pair<lng, lng>>& arcs,
+    const std::vector<lng>& rootLabel, std::vector<std::vector<std::pair<int, lng>>>& labels,
+    std::vector<lng>& dist, std::vector<lng>& touched)
+{
+    lng root = order[rank];
+    std::priority_queue<std::pair<lng, lng>, std::vector<std::pair<lng, lng>>, std::greater<std::pair<lng, lng>>> pq;
+    dist[root] = 0;
+    touched.push_back(root);
+    pq.push({ 0, root });
+
+    while (!pq.empty()) {
+        lng d = pq.top().first;
+        lng f = pq.top().second;
+        pq.pop();
+        if (d > dist[f])
+            continue;
+
+        // skip f when a higher ranked hub already certifies a path not longer than d
+        bool covered = false;
+        if (f != root) {
+            for (const auto& entry : labels[f]) {
+                if (rootLabel[entry.first] != LLONG_MAX && rootLabel[entry.first] + entry.second <= d) {
+                    covered = true;
+                    break;
+                }
+            }
+        }
+        if (covered)
+            continue;
+
+        labels[f].push_back({ rank, d });
+
+        for (lng i = offset[f]; i < offset[f + 1]; i++) {
+            lng s = arcs[i].first;
+            lng w = arcs[i].second;
+            if (d + w < dist[s]) {
+                if (dist[s] == LLONG_MAX)
+                    touched.push_back(s);
+                dist[s] = d + w;
+                pq.push({ dist[s], s });
+            }
+        }
+    }
+
+    for (lng v : touched)
+        dist[v] = LLONG_MAX;
+    touched.clear();
+}
+
+/// <summary>
+/// Number of label entries stored (without padding)
+/// </summary>
+size_t HubLabeling::LabelEntries() const
+{
+    size_t count = 0;
+    for (int hub : outHubs)
+        count += hub != INT_MAX;
+    for (int hub : inHubs)
+        count += hub != INT_MAX;
+    return count;
+}
+
+/// <summary>
+/// Distance query by intersection of the out-label of src and the in-label of dst
+/// </summary>
+/// <param name="src">Start vertex</param>
+/// <param name="dst">Final vertex</param>
+/// <returns>Distance(weight) of the shortest path, LLONG_MAX if dst is unreachable</returns>
+lng HubLabeling::Query(lng src, lng dst) const
+{
+    const int* a = outHubs.data() + outOffset[src];
+    const int* b = inHubs.data() + inOffset[dst];
+    const lng* da = outDist.data() + outOffset[src];
+    const lng* db = inDist.data() + inOffset[dst];
+    lng lenA = outOffset[src + 1] - outOffset[src];
+    lng lenB = inOffset[dst + 1] - inOffset[dst];
+
+    lng best = LLONG_MAX;
+    lng i = 0, j = 0;
+
+#ifdef HUB_LABELING_SSE2
+    /*
+        Compare blocks of 4 hubs against all 4 rotations of the other block,
+        then advance the block with the smaller last hub (both if equal)
+    */
+    while (i < lenA && j < lenB && a[i] != INT_MAX && b[j] != INT_MAX) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+        int masks[4];
+        masks[0] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, vb)));
+        masks[1] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))));
+        masks[2] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)))));
+        masks[3] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+
+        if (masks[0] | masks[1] | masks[2] | masks[3]) {
+            for (int r = 0; r < 4; r++) {
+                for (int k = 0; k < 4; k++) {
+                    if ((masks[r] >> k & 1) && a[i + k] != INT_MAX) {
+                        lng d = da[i + k] + db[j + (k + r) % 4];
+                        if (d < best)
+                            best = d;
+                    }
+                }
+            }
+        }
+
+        int lastA = a[i + 3], lastB = b[j + 3];
+        if (lastA <= lastB)
+            i += 4;
+        if (lastB <= lastA)
+            j += 4;
+    }
+#else
+    while (i < lenA && j < lenB && a[i] != INT_MAX && b[j] != INT_MAX) {
+        if (a[i] < b[j])
+            i++;
+        else if (a[i] > b[j])
+            j++;
+        else {
+            if (da[i] + db[j] < best)
+                best = da[i] + db[j];
+            i++;
+            j++;
+        }
+    }
+#endif
+
+    return best;
+}
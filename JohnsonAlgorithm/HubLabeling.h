@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Edge.h"
+
+#define lng long long
+
+/// <summary>
+/// Hub labeling distance index built by pruned landmark labeling.
+/// Every vertex keeps an out-label (hubs it reaches) and an in-label
+/// (hubs reaching it), a query intersects the two sorted labels.
+/// </summary>
+class HubLabeling
+{
+public:
+    HubLabeling(const std::vector<Edge>& edges, lng V, bool parallel = false);
+
+    lng Query(lng src, lng dst) const;
+
+    lng VertexCount() const { return V; }
+    size_t LabelEntries() const;
+
+private:
+    lng V;
+
+    /// <summary>
+    /// Vertex processed as the k-th hub, hubs are stored in labels by this rank
+    /// </summary>
+    std::vector<lng> order;
+
+    /*
+        Labels in CSR form, sorted by hub rank and padded with INT_MAX
+        to a multiple of 4 entries so queries can compare 4 hubs at once
+    */
+    std::vector<lng> outOffset, inOffset;
+    std::vector<int> outHubs, inHubs;
+    std::vector<lng> outDist, inDist;
+
+    void PrunedDijkstra(int rank, const std::vector<lng>& offset, const std::vector<std::pair<lng, lng>>& arcs,
+        const std::vector<lng>& rootLabel, std::vector<std::vector<std::pair<int, lng>>>& labels,
+        std::vector<lng>& dist, std::vector<lng>& touched);
+};
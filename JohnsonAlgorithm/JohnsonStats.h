@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MemoryAccounting.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+
+#define lng long long
+
+/*
+    Statistics are collected unless JOHNSON_STATS is defined as 0, then the
+    counters and phase marks compile to nothing and the stats stay empty
+*/
+#ifndef JOHNSON_STATS
+#define JOHNSON_STATS 1
+#endif
+
+#if JOHNSON_STATS
+#define STATS_ADD(stats, field, n) ((stats).field += (n))
+#else
+#define STATS_ADD(stats, field, n) ((void)(stats)) // keeps counter parameters used
+#endif
+
+/// <summary>
+/// Work of the shortest path searches. Every worker counts into its own copy
+/// on the stack, the copies are summed when the worker is done.
+/// </summary>
+struct SearchCounters {
+    lng relaxations = 0; // arcs scanned
+    lng pushes = 0;
+    lng pops = 0;
+    lng stalePops = 0; // outdated heap entries, skipped
+    lng decreaseKeys = 0; // pushes of a vertex that already had a tentative distance
+
+    SearchCounters& operator+=(const SearchCounters& other) {
+        relaxations += other.relaxations;
+        pushes += other.pushes;
+        pops += other.pops;
+        stalePops += other.stalePops;
+        decreaseKeys += other.decreaseKeys;
+        return *this;
+    }
+};
+
+/// <summary>
+/// Phases and counters of one Johnson run
+/// </summary>
+struct JohnsonStats {
+    /// <summary>
+    /// Microseconds of every phase in order of first appearance
+    /// </summary>
+    std::vector<std::pair<std::string, lng>> phases;
+
+    SearchCounters counters;
+    lng bellmanFordPasses = 0;
+
+    /// <summary>
+    /// Hardware events of the calling thread in every phase, filled while PerfScope is enabled
+    /// </summary>
+    std::vector<std::pair<std::string, HardwareCounters>> hardware;
+
+    /// <summary>
+    /// Hardware events of the worker tasks, summed over the workers
+    /// </summary>
+    HardwareCounters workerHardware;
+
+    /// <summary>
+    /// Counted allocations of every phase: bytes and allocations made in it,
+    /// bytes live at its end and the peak during it
+    /// </summary>
+    std::vector<std::pair<std::string, MemoryCounters>> memory;
+
+    /// <summary>
+    /// Bytes of the distance and parent matrices returned to the caller, and of the
+    /// edge list and adjacency list of the graph (not counted by MemoryAccounting)
+    /// </summary>
+    lng resultBytes = 0;
+    lng graphBytes = 0;
+
+    /// <summary>
+    /// Peak resident set of the process at the end of the run, see MemoryAccounting
+    /// </summary>
+    lng peakResidentKilobytes = 0;
+
+    /// <summary>
+    /// Adds time to a phase, a phase that appears twice is summed
+    /// </summary>
+    void AddPhase(const std::string& name, lng microseconds) {
+        for (auto& phase : phases) {
+            if (phase.first == name) {
+                phase.second += microseconds;
+                return;
+            }
+        }
+        phases.emplace_back(name, microseconds);
+    }
+
+    void AddMemory(const std::string& name, const MemoryCounters& counters) {
+        for (auto& phase : memory) {
+            if (phase.first == name) {
+                phase.second.allocated += counters.allocated;
+                phase.second.allocations += counters.allocations;
+                phase.second.live = counters.live;
+                phase.second.peak = std::max(phase.second.peak, counters.peak);
+                return;
+            }
+        }
+        memory.emplace_back(name, counters);
+    }
+
+    void AddHardware(const std::string& name, const HardwareCounters& events) {
+        for (auto& phase : hardware) {
+            if (phase.first == name) {
+                phase.second += events;
+                return;
+            }
+        }
+        hardware.emplace_back(name, events);
+    }
+
+    /// <summary>
+    /// Microseconds of a phase, 0 if it did not run
+    /// </summary>
+    lng Phase(const std::string& name) const {
+        for (const auto& phase : phases)
+            if (phase.first == name)
+                return phase.second;
+        return 0;
+    }
+};
+
+/// <summary>
+/// Times consecutive phases: every Mark closes the phase started by the previous one.
+/// While PerfScope is enabled the hardware events of the phase are recorded as well,
+/// while Trace is enabled the phase is a span of the timeline.
+/// Counted memory is measured per phase, the peak is reset at every Mark.
+/// </summary>
+class PhaseTimer {
+public:
+    explicit PhaseTimer(JohnsonStats& stats)
+        : stats(stats), start(std::chrono::high_resolution_clock::now()), traceStart(Trace::Enabled() ? Trace::Now() : 0) {
+#if JOHNSON_STATS
+        MemoryAccounting::ResetPeak();
+        memoryStart = MemoryAccounting::Snapshot();
+#endif
+    }
+
+    /// <summary>
+    /// Records a phase measured elsewhere, the running phase is not closed
+    /// </summary>
+    void Record([[maybe_unused]] const char* name, [[maybe_unused]] lng microseconds) {
+#if JOHNSON_STATS
+        stats.AddPhase(name, microseconds);
+#endif
+    }
+
+    void Mark(const char* name) {
+        if (Trace::Enabled()) {
+            lng now = Trace::Now();
+            Trace::Complete(name, traceStart, now);
+            traceStart = now;
+        }
+#if JOHNSON_STATS
+        auto now = std::chrono::high_resolution_clock::now();
+        stats.AddPhase(name, std::chrono::duration_cast<std::chrono::microseconds>(now - start).count());
+        start = now;
+
+        MemoryCounters memory = MemoryAccounting::Snapshot();
+        MemoryCounters phase = memory;
+        phase.allocated -= memoryStart.allocated;
+        phase.allocations -= memoryStart.allocations;
+        stats.AddMemory(name, phase);
+        MemoryAccounting::ResetPeak();
+        memoryStart = memory;
+
+        HardwareCounters events = scope.Read();
+        if (events.valid) {
+            stats.AddHardware(name, events);
+            scope.Restart();
+        }
+#endif
+    }
+
+private:
+    JohnsonStats& stats;
+    std::chrono::high_resolution_clock::time_point start;
+    PerfScope scope;
+    lng traceStart;
+    MemoryCounters memoryStart;
+};
@@ -0,0 +1,91 @@
+#include "MemoryAccounting.h"
+
+#if defined(__linux__)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+std::atomic<lng> MemoryAccounting::allocated{ 0 };
+std::atomic<lng> MemoryAccounting::allocations{ 0 };
+std::atomic<lng> MemoryAccounting::live{ 0 };
+std::atomic<lng> MemoryAccounting::peak{ 0 };
+
+void MemoryAccounting::Allocate(size_t bytes)
+{
+    allocated.fetch_add(bytes, std::memory_order_relaxed);
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    lng now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+    lng highest = peak.load(std::memory_order_relaxed);
+    while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {}
+}
+
+void MemoryAccounting::Deallocate(size_t bytes)
+{
+    live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Current counters
+/// </summary>
+MemoryCounters MemoryAccounting::Snapshot()
+{
+    MemoryCounters counters;
+    counters.allocated = allocated.load(std::memory_order_relaxed);
+    counters.allocations = allocations.load(std::memory_order_relaxed);
+    counters.live = live.load(std::memory_order_relaxed);
+    counters.peak = peak.load(std::memory_order_relaxed);
+    return counters;
+}
+
+/// <summary>
+/// Starts a new peak from the bytes live now
+/// </summary>
+void MemoryAccounting::ResetPeak()
+{
+    peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Counting resource over new and delete, the default upstream of the solver's arenas
+/// </summary>
+std::pmr::memory_resource* MemoryAccounting::Resource()
+{
+    static CountingResource resource;
+    return &resource;
+}
+
+/// <summary>
+/// Peak resident set of the process: VmHWM of /proc/self/status on Linux,
+/// the peak working set on Windows
+/// </summary>
+/// <returns>Kilobytes, 0 if unknown</returns>
+lng MemoryAccounting::PeakResidentKilobytes()
+{
+#if defined(__linux__)
+    FILE* status = std::fopen("/proc/self/status", "r");
+    if (!status)
+        return 0;
+    char line[256];
+    lng kilobytes = 0;
+    while (std::fgets(line, sizeof(line), status)) {
+        if (std::strncmp(line, "VmHWM:", 6) == 0) {
+            kilobytes = std::atoll(line + 6);
+            break;
+        }
+    }
+    std::fclose(status);
+    return kilobytes;
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    return 0;
+#endif
+}
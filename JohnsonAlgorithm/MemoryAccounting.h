@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include "Placement.h"
+
+#define lng long long
+
+/// <summary>
+/// Bytes requested through CountingAllocator, in total or over a phase
+/// </summary>
+struct MemoryCounters {
+    lng allocated = 0; // bytes allocated, frees are not subtracted
+    lng allocations = 0;
+    lng live = 0; // bytes allocated and not yet freed
+    lng peak = 0; // largest live value
+};
+
+/// <summary>
+/// Process-wide accounting of the containers that use CountingAllocator.
+/// Phases read a Snapshot and call ResetPeak at their start, so runs on
+/// several threads at once share the peak.
+/// </summary>
+class MemoryAccounting {
+public:
+    static void Allocate(size_t bytes);
+
+    static void Deallocate(size_t bytes);
+
+    static MemoryCounters Snapshot();
+
+    static void ResetPeak();
+
+    static lng PeakResidentKilobytes();
+
+    static std::pmr::memory_resource* Resource();
+
+private:
+    static std::atomic<lng> allocated;
+    static std::atomic<lng> allocations;
+    static std::atomic<lng> live;
+    static std::atomic<lng> peak;
+};
+
+/// <summary>
+/// std::allocator that reports every allocation to MemoryAccounting. Blocks of
+/// a huge page or more get huge page advice if Placement::EnableHugePages is on.
+/// </summary>
+template <class T>
+struct CountingAllocator {
+    typedef T value_type;
+
+    CountingAllocator() = default;
+
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        T* memory = std::allocator<T>().allocate(n);
+        MemoryAccounting::Allocate(n * sizeof(T));
+        if (n * sizeof(T) >= Placement::HUGE_PAGE && Placement::HugePagesEnabled())
+            Placement::AdviseHugePages(memory, n * sizeof(T));
+        return memory;
+    }
+
+    void deallocate(T* memory, size_t n) {
+        MemoryAccounting::Deallocate(n * sizeof(T));
+        std::allocator<T>().deallocate(memory, n);
+    }
+
+    template <class U>
+    bool operator==(const CountingAllocator<U>&) const { return true; }
+
+    template <class U>
+    bool operator!=(const CountingAllocator<U>&) const { return false; }
+};
+
+/// <summary>
+/// Memory resource that reports every allocation to MemoryAccounting and
+/// takes the memory from its upstream. Thread safe if the upstream is.
+/// Counters() tells the requests that went through this resource alone.
+/// </summary>
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : upstream(upstream) {}
+
+    MemoryCounters Counters() const {
+        MemoryCounters counters;
+        counters.allocated = allocated.load(std::memory_order_relaxed);
+        counters.allocations = allocations.load(std::memory_order_relaxed);
+        counters.live = live.load(std::memory_order_relaxed);
+        counters.peak = peak.load(std::memory_order_relaxed);
+        return counters;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = upstream->allocate(bytes, alignment);
+        MemoryAccounting::Allocate(bytes);
+        allocated.fetch_add(bytes, std::memory_order_relaxed);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        lng now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        lng highest = peak.load(std::memory_order_relaxed);
+        while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {}
+        return memory;
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        MemoryAccounting::Deallocate(bytes);
+        live.fetch_sub(bytes, std::memory_order_relaxed);
+        upstream->deallocate(memory, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream;
+    std::atomic<lng> allocated{ 0 };
+    std::atomic<lng> allocations{ 0 };
+    std::atomic<lng> live{ 0 };
+    std::atomic<lng> peak{ 0 };
+};
+
+template <class T>
+using CountedVector = std::vector<T, CountingAllocator<T>>;
@@ -0,0 +1,139 @@
+#include "PerfCounters.h"
+
+#include <atomic>
+
+#ifdef __linux__
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<bool> perfEnabled{ false };
+
+#ifdef __linux__
+namespace {
+    /// <summary>
+    /// Event counters of one thread, -1 for the events that could not be opened
+    /// </summary>
+    struct ThreadEvents {
+        int fd[5];
+        bool opened = false;
+
+        ThreadEvents() {
+            for (int& descriptor : fd)
+                descriptor = -1;
+        }
+
+        ~ThreadEvents() {
+            for (int descriptor : fd)
+                if (descriptor >= 0)
+                    close(descriptor);
+        }
+
+        /// <summary>
+        /// Opens the counters of the calling thread, user space only so that
+        /// perf_event_paranoid 2 still allows them
+        /// </summary>
+        void Open() {
+            const uint32_t type[5] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+            const uint64_t config[5] = {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES, // last level cache on most processors
+                PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                PERF_COUNT_HW_BRANCH_MISSES
+            };
+
+            for (int i = 0; i < 5; i++) {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = type[i];
+                attr.config = config[i];
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                fd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            }
+            opened = true;
+        }
+
+        /// <summary>
+        /// Count of an event, scaled up for the time it was multiplexed out
+        /// </summary>
+        /// <returns>Count, -1 if the event is not open</returns>
+        lng Value(int i) const {
+            if (fd[i] < 0)
+                return -1;
+            uint64_t data[3]; // value, time enabled, time running
+            if (read(fd[i], data, sizeof(data)) != (ssize_t)sizeof(data))
+                return -1;
+            if (data[2] == 0)
+                return 0;
+            return (lng)((double)data[0] * data[1] / data[2]);
+        }
+    };
+
+    thread_local ThreadEvents threadEvents;
+}
+#endif
+
+PerfScope::PerfScope() : active(false) {
+    Restart();
+}
+
+/// <summary>
+/// Starts counting again from now
+/// </summary>
+void PerfScope::Restart() {
+    active = false;
+#ifdef __linux__
+    if (!perfEnabled.load(std::memory_order_relaxed))
+        return;
+    if (!threadEvents.opened)
+        threadEvents.Open();
+    for (int i = 0; i < EVENTS; i++) {
+        start[i] = threadEvents.Value(i);
+        if (start[i] >= 0)
+            active = true;
+    }
+#endif
+}
+
+/// <summary>
+/// Events since the start of the scope, must be called on the thread that started it
+/// </summary>
+/// <returns>Counters, invalid if profiling is off or unavailable</returns>
+HardwareCounters PerfScope::Read() const {
+    HardwareCounters counters;
+#ifdef __linux__
+    if (!active)
+        return counters;
+
+    lng* field[EVENTS] = { &counters.cycles, &counters.instructions, &counters.llcMisses, &counters.dtlbMisses, &counters.branchMisses };
+    for (int i = 0; i < EVENTS; i++) {
+        if (start[i] < 0)
+            continue;
+        lng now = threadEvents.Value(i);
+        if (now < 0)
+            continue;
+        // scaled counts of a multiplexed event may step back slightly
+        *field[i] = now > start[i] ? now - start[i] : 0;
+        counters.valid = true;
+    }
+#endif
+    return counters;
+}
+
+/// <summary>
+/// Turns profiling on or off for the scopes started afterwards
+/// </summary>
+void PerfScope::Enable(bool enabled) {
+    perfEnabled = enabled;
+}
+
+bool PerfScope::Enabled() {
+    return perfEnabled;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#define lng long long
+
+/// <summary>
+/// Hardware events of a measured region, summed over the threads that ran it
+/// </summary>
+struct HardwareCounters {
+    lng cycles = 0;
+    lng instructions = 0;
+    lng llcMisses = 0;
+    lng dtlbMisses = 0;
+    lng branchMisses = 0;
+    bool valid = false; // false if no event could be read, the values are then 0
+
+    HardwareCounters& operator+=(const HardwareCounters& other) {
+        cycles += other.cycles;
+        instructions += other.instructions;
+        llcMisses += other.llcMisses;
+        dtlbMisses += other.dtlbMisses;
+        branchMisses += other.branchMisses;
+        valid = valid || other.valid;
+        return *this;
+    }
+};
+
+/// <summary>
+/// Counts the hardware events of the calling thread since construction or the last Restart.
+/// Uses perf_event_open on Linux, the counters of a thread are opened by its first scope
+/// and stay open until the thread exits. Does nothing unless Enable(true) was called;
+/// on other systems, without permission (perf_event_paranoid) or on hardware without
+/// an event, the missing events read as 0 and valid stays false if none could be opened.
+/// </summary>
+class PerfScope {
+public:
+    PerfScope();
+
+    void Restart();
+
+    HardwareCounters Read() const;
+
+    static void Enable(bool enabled);
+
+    static bool Enabled();
+
+private:
+    static const int EVENTS = 5;
+    lng start[EVENTS];
+    bool active;
+};
@@ -0,0 +1,202 @@
+#include "Placement.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+static std::atomic<bool> hugePagesEnabled{ false };
+
+namespace {
+    /// <summary>
+    /// Node of every cpu, read once
+    /// </summary>
+    struct Topology {
+        int nodes = 1;
+        std::vector<int> cpuNode;
+        std::vector<int> workerCpu; // cpus taking the nodes in turn, so small pools span all of them
+
+        Topology() {
+            int cpus = std::thread::hardware_concurrency();
+            if (cpus < 1)
+                cpus = 1;
+            cpuNode.assign(cpus, 0);
+#if defined(__linux__)
+            char path[96];
+            for (int node = 0;; node++) {
+                std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+                if (access(path, F_OK) != 0)
+                    break;
+                nodes = node + 1;
+                for (int cpu = 0; cpu < cpus; cpu++) {
+                    std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpu%d", node, cpu);
+                    if (access(path, F_OK) == 0)
+                        cpuNode[cpu] = node;
+                }
+            }
+#elif defined(_WIN32)
+            ULONG highest = 0;
+            if (GetNumaHighestNodeNumber(&highest))
+                nodes = highest + 1;
+            for (int cpu = 0; cpu < cpus && cpu < 64; cpu++) {
+                UCHAR node = 0;
+                if (GetNumaProcessorNode((UCHAR)cpu, &node) && node < nodes)
+                    cpuNode[cpu] = node;
+            }
+#endif
+            std::vector<std::vector<int>> members(nodes);
+            for (int cpu = 0; cpu < cpus; cpu++)
+                members[cpuNode[cpu]].push_back(cpu);
+            for (size_t k = 0; (int)workerCpu.size() < cpus; k++)
+                for (const auto& cpusOfNode : members)
+                    if (k < cpusOfNode.size())
+                        workerCpu.push_back(cpusOfNode[k]);
+        }
+    };
+
+    const Topology& Machine() {
+        static Topology topology;
+        return topology;
+    }
+}
+
+/// <summary>
+/// Number of NUMA nodes, 1 if unknown
+/// </summary>
+int Placement::NodeCount()
+{
+    return Machine().nodes;
+}
+
+/// <summary>
+/// Node of a cpu, 0 if unknown
+/// </summary>
+int Placement::NodeOfCpu(int cpu)
+{
+    const Topology& topology = Machine();
+    return cpu >= 0 && cpu < (int)topology.cpuNode.size() ? topology.cpuNode[cpu] : 0;
+}
+
+/// <summary>
+/// Node of the cpu the calling thread runs on. An unpinned thread may move
+/// to another node right after, which only costs remote accesses.
+/// </summary>
+int Placement::CurrentNode()
+{
+#if defined(__linux__)
+    return NodeOfCpu(sched_getcpu());
+#elif defined(_WIN32)
+    return NodeOfCpu(GetCurrentProcessorNumber());
+#else
+    return 0;
+#endif
+}
+
+/// <summary>
+/// Cpu of the worker with the given index: the nodes take turns, so the workers
+/// of a pool smaller than the machine are spread over all of its nodes
+/// </summary>
+int Placement::WorkerCpu(size_t worker)
+{
+    const Topology& topology = Machine();
+    return topology.workerCpu[worker % topology.workerCpu.size()];
+}
+
+/// <summary>
+/// Restricts a thread to one cpu
+/// </summary>
+/// <returns>False if the system refused or has no affinity API</returns>
+bool Placement::Pin(std::thread& thread, int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    if (cpu >= 64)
+        return false;
+    return SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    (void)thread;
+    (void)cpu;
+    return false;
+#endif
+}
+
+/// <summary>
+/// Memory the system can still hand out without swapping:
+/// MemAvailable of /proc/meminfo on Linux, the available physical memory on Windows
+/// </summary>
+/// <returns>Bytes, 0 if unknown</returns>
+lng Placement::AvailableBytes()
+{
+#if defined(__linux__)
+    FILE* meminfo = std::fopen("/proc/meminfo", "r");
+    if (!meminfo)
+        return 0;
+    char line[256];
+    lng kilobytes = 0;
+    while (std::fgets(line, sizeof(line), meminfo)) {
+        if (std::strncmp(line, "MemAvailable:", 13) == 0) {
+            kilobytes = std::atoll(line + 13);
+            break;
+        }
+    }
+    std::fclose(meminfo);
+    return kilobytes * 1024;
+#elif defined(_WIN32)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status))
+        return 0;
+    return status.ullAvailPhys;
+#else
+    return 0;
+#endif
+}
+
+/// <summary>
+/// Turns huge page advice for large arrays on or off, off by default
+/// </summary>
+void Placement::EnableHugePages(bool enabled)
+{
+    hugePagesEnabled = enabled;
+}
+
+bool Placement::HugePagesEnabled()
+{
+    return hugePagesEnabled;
+}
+
+/// <summary>
+/// Asks for transparent huge pages on the whole huge pages inside a block that has
+/// not been touched yet (MADV_HUGEPAGE). Windows only maps large pages with a
+/// privilege and its own allocation, so there it does nothing.
+/// </summary>
+/// <returns>True if some range of the block was advised</returns>
+bool Placement::AdviseHugePages(void* memory, size_t bytes)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    uintptr_t begin = ((uintptr_t)memory + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1);
+    uintptr_t end = ((uintptr_t)memory + bytes) & ~(uintptr_t)(HUGE_PAGE - 1);
+    if (end <= begin)
+        return false;
+    return madvise((void*)begin, end - begin, MADV_HUGEPAGE) == 0;
+#else
+    (void)memory;
+    (void)bytes;
+    return false;
+#endif
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+#define lng long long
+
+/// <summary>
+/// Where GraphMT keeps its memory and runs its workers on a machine with several NUMA nodes
+/// </summary>
+struct PlacementOptions {
+    bool pinWorkers = false; // worker i runs only on Placement::WorkerCpu(i)
+    bool firstTouch = false; // result rows are allocated by the worker that computes them (one Dijkstra per task only)
+    bool replicateCsr = false; // every node reads its own copy of the reduced adjacency, if memory allows
+};
+
+/// <summary>
+/// Memory and thread placement. Reads the topology from sysfs and uses madvise and
+/// pthread affinity on Linux, the NUMA and affinity API on Windows; elsewhere the
+/// machine is one node and the calls do nothing.
+/// </summary>
+class Placement {
+public:
+    static const size_t HUGE_PAGE = 2 << 20;
+
+    static int NodeCount();
+
+    static int NodeOfCpu(int cpu);
+
+    static int CurrentNode();
+
+    static int WorkerCpu(size_t worker);
+
+    static bool Pin(std::thread& thread, int cpu);
+
+    static lng AvailableBytes();
+
+    static void EnableHugePages(bool enabled);
+
+    static bool HugePagesEnabled();
+
+    static bool AdviseHugePages(void* memory, size_t bytes);
+};
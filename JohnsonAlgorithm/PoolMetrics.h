@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#define lng long long
+
+/// <summary>
+/// Log-linear latency histogram in the style of HdrHistogram: values below 8 have
+/// their own bucket, above that every power of two is split into 8 buckets, so a
+/// bucket spans at most 1/8 of its values and percentiles are within 12.5%.
+/// </summary>
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int BUCKETS = 64 * SUB_BUCKETS;
+
+    LatencyHistogram() : counts(BUCKETS, 0), count(0), max(0) {}
+
+    static int Bucket(lng value) {
+        if (value < SUB_BUCKETS)
+            return value < 0 ? 0 : (int)value;
+        int exponent = 0;
+        for (lng rest = value; rest > 1; rest >>= 1)
+            exponent++;
+        int sub = (int)((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+        return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    /// <summary>
+    /// Largest value of a bucket
+    /// </summary>
+    static lng BucketMax(int bucket) {
+        if (bucket < SUB_BUCKETS)
+            return bucket;
+        int exponent = bucket / SUB_BUCKETS + SUB_BITS - 1;
+        lng low = (lng)(SUB_BUCKETS + bucket % SUB_BUCKETS) << (exponent - SUB_BITS);
+        return low + ((1LL << (exponent - SUB_BITS)) - 1);
+    }
+
+    void Record(lng value) {
+        counts[Bucket(value)]++;
+        count++;
+        if (value > max)
+            max = value;
+    }
+
+    void Add(int bucket, lng n) {
+        counts[bucket] += n;
+        count += n;
+    }
+
+    void SetMax(lng value) {
+        if (value > max)
+            max = value;
+    }
+
+    lng Count() const { return count; }
+
+    lng Max() const { return max; }
+
+    /// <summary>
+    /// Smallest bucket bound that covers the fraction q of the values
+    /// </summary>
+    /// <param name="q">Fraction in [0, 1]</param>
+    /// <returns>Value, 0 for an empty histogram</returns>
+    lng Percentile(double q) const {
+        if (count == 0)
+            return 0;
+        lng rank = (lng)(q * count);
+        if (rank < 1)
+            rank = 1;
+        lng seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank)
+                return BucketMax(b) < max ? BucketMax(b) : max;
+        }
+        return max;
+    }
+
+private:
+    std::vector<lng> counts;
+    lng count;
+    lng max;
+};
+
+/// <summary>
+/// Measurements of one worker. Only the worker writes them (relaxed loads and stores,
+/// no read-modify-write), snapshots read them from any thread.
+/// </summary>
+struct WorkerShard {
+    std::atomic<lng> completed{ 0 };
+    std::atomic<lng> idleNanoseconds{ 0 };
+    std::atomic<lng> waitBuckets[LatencyHistogram::BUCKETS];
+    std::atomic<lng> executionBuckets[LatencyHistogram::BUCKETS];
+    std::atomic<lng> waitMax{ 0 };
+    std::atomic<lng> executionMax{ 0 };
+
+    WorkerShard() {
+        for (int b = 0; b < LatencyHistogram::BUCKETS; b++) {
+            waitBuckets[b].store(0, std::memory_order_relaxed);
+            executionBuckets[b].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void Bump(std::atomic<lng>& counter, lng n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void Raise(std::atomic<lng>& counter, lng value) {
+        if (value > counter.load(std::memory_order_relaxed))
+            counter.store(value, std::memory_order_relaxed);
+    }
+
+    void RecordTask(lng waitNanoseconds, lng executionNanoseconds) {
+        Bump(waitBuckets[LatencyHistogram::Bucket(waitNanoseconds)], 1);
+        Bump(executionBuckets[LatencyHistogram::Bucket(executionNanoseconds)], 1);
+        Raise(waitMax, waitNanoseconds);
+        Raise(executionMax, executionNanoseconds);
+        Bump(completed, 1);
+    }
+};
+
+/// <summary>
+/// Snapshot of a ThreadPool, latencies in nanoseconds
+/// </summary>
+struct ThreadPoolMetrics {
+    lng submitted = 0;
+    lng completed = 0;
+    lng queueDepth = 0;
+    lng peakQueueDepth = 0;
+    std::vector<lng> idleMicroseconds; // per worker, waiting for a task
+    LatencyHistogram queueWait; // from Submit or Enqueue until a worker takes the task
+    LatencyHistogram execution;
+};
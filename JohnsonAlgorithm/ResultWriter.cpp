@@ -0,0 +1,195 @@
+#include "ResultWriter.h"
+
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "ThreadPool.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Appends the decimal digits of a value
+/// </summary>
+void ResultWriter::Buffer::Number(lng value)
+{
+    char* begin = Reserve(20);
+    size += std::to_chars(begin, begin + 20, value).ptr - begin;
+}
+
+/// <summary>
+/// Formats the answers of the queries into the chunk buffers, replacing the previous ones
+/// </summary>
+/// <param name="distances">Distances of the shortest paths, indexed by source and target</param>
+/// <param name="paths">Parents on the shortest paths, indexed by source and vertex</param>
+/// <param name="queries">Queries within 1..V</param>
+/// <param name="V">Number of vertices</param>
+void ResultWriter::Format(const std::vector<std::vector<lng>>& distances, const std::vector<std::vector<lng>>& paths,
+    const std::vector<Query>& queries, lng V)
+{
+    // answers before every query
+    std::vector<lng> rows(queries.size() + 1, 0);
+    for (size_t q = 0; q < queries.size(); q++)
+        rows[q + 1] = rows[q] + (queries[q].second ? 1 : V);
+
+    size_t T = std::max<size_t>(1, threads);
+    lng count = std::max<lng>(1, std::min<lng>(rows.back(), 4 * T));
+    lng step = (rows.back() + count - 1) / count;
+    chunks.clear();
+    chunks.resize(1 + count);
+
+    if (format == OutputFormat::Csv)
+        chunks[0].Append("source,target,distance,path\n", 28);
+    else if (format == OutputFormat::Tsv)
+        chunks[0].Append("source\ttarget\tdistance\tpath\n", 28);
+    else if (format == OutputFormat::Binary)
+        chunks[0].Append("JSP1", 4);
+    if (format == OutputFormat::None || rows.back() == 0)
+        return;
+
+    // several chunks per worker, so a worker with long paths does not hold up the others
+    ThreadPool pool(T);
+    Latch done(count);
+    for (lng c = 0; c < count; c++) {
+        pool.Submit([&, c] {
+            lng begin = std::min(rows.back(), c * step);
+            lng end = std::min(rows.back(), begin + step);
+            FormatChunk(distances, paths, queries, rows, begin, end, chunks[1 + c]);
+            done.CountDown();
+        });
+    }
+    done.Wait();
+}
+
+/// <summary>
+/// Formats the answers begin .. end - 1 of the batch
+/// </summary>
+/// <param name="rows">Answers before every query</param>
+void ResultWriter::FormatChunk(const std::vector<std::vector<lng>>& distances, const std::vector<std::vector<lng>>& paths,
+    const std::vector<Query>& queries, const std::vector<lng>& rows, lng begin, lng end, Buffer& out) const
+{
+    if (begin >= end)
+        return;
+    char separator = format == OutputFormat::Tsv ? '\t' : ',';
+    std::vector<lng> path;
+
+    size_t q = std::upper_bound(rows.begin(), rows.end(), begin) - rows.begin() - 1;
+    for (lng r = begin; r < end; r++) {
+        while (rows[q + 1] <= r)
+            q++;
+        lng src = queries[q].first;
+        lng v = queries[q].second ? queries[q].second : 1 + (r - rows[q]);
+        lng distance = distances[src][v];
+
+        // parents lead from v back to src
+        path.clear();
+        if (distance != LLONG_MAX) {
+            for (lng u = v; u != src; u = paths[src][u])
+                path.push_back(u);
+            path.push_back(src);
+        }
+
+        if (format == OutputFormat::Binary) {
+            lng header[4] = { src, v, distance, (lng)path.size() };
+            out.Append((const char*)header, sizeof(header));
+            for (auto it = path.rbegin(); it != path.rend(); ++it)
+                out.Append((const char*)&*it, sizeof(lng));
+            continue;
+        }
+
+        out.Number(src);
+        out.Append(&separator, 1);
+        out.Number(v);
+        out.Append(&separator, 1);
+        if (distance != LLONG_MAX)
+            out.Number(distance);
+        out.Append(&separator, 1);
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            if (it != path.rbegin())
+                out.Append(" ", 1);
+            out.Number(*it);
+        }
+        out.Append("\n", 1);
+    }
+}
+
+/// <summary>
+/// Total size of the formatted answers
+/// </summary>
+size_t ResultWriter::Bytes() const
+{
+    size_t bytes = 0;
+    for (const Buffer& chunk : chunks)
+        bytes += chunk.size;
+    return bytes;
+}
+
+/// <summary>
+/// Writes the formatted answers to a stream, one write per buffer
+/// </summary>
+void ResultWriter::Write(std::ostream& out) const
+{
+    for (const Buffer& chunk : chunks)
+        out.write(chunk.data.get(), chunk.size);
+    out.flush();
+}
+
+/// <summary>
+/// Writes the formatted answers to a file, replacing it, or to the standard output
+/// </summary>
+/// <param name="path">File name, empty for the standard output</param>
+/// <returns>False if the file could not be opened or written</returns>
+bool ResultWriter::Write(const std::string& path)
+{
+#if defined(__linux__) || defined(__APPLE__)
+    std::cout.flush();
+    int fd = path.empty() ? STDOUT_FILENO : open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    std::vector<iovec> pending;
+    for (Buffer& chunk : chunks)
+        if (chunk.size)
+            pending.push_back({ chunk.data.get(), chunk.size });
+
+    // writev may take fewer buffers than given or stop inside one
+    bool written = true;
+    size_t next = 0;
+    while (next < pending.size()) {
+        int count = (int)std::min<size_t>(pending.size() - next, IOV_MAX);
+        ssize_t bytes = writev(fd, &pending[next], count);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0) {
+            written = false;
+            break;
+        }
+        while (next < pending.size() && (size_t)bytes >= pending[next].iov_len)
+            bytes -= pending[next++].iov_len;
+        if (next < pending.size()) {
+            pending[next].iov_base = (char*)pending[next].iov_base + bytes;
+            pending[next].iov_len -= bytes;
+        }
+    }
+    if (!path.empty())
+        written = close(fd) == 0 && written;
+    return written;
+#else
+    if (path.empty()) {
+        Write(std::cout);
+        return (bool)std::cout;
+    }
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open())
+        return false;
+    Write(out);
+    return (bool)out;
+#endif
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define lng long long
+
+enum class OutputFormat {
+    None,
+    Csv,
+    Tsv,
+    Binary
+};
+
+/// <summary>
+/// Shortest path query, target 0 asks for every target of the source
+/// </summary>
+typedef std::pair<lng, lng> Query;
+
+/// <summary>
+/// Formats the answers of a batch of queries and writes them at once.
+/// The answers are split into chunks of about the same number of rows, the chunks are
+/// formatted in parallel with std::to_chars, each into its own buffer, and the buffers
+/// are written in query order with one writev (one write per buffer on other systems).
+///
+/// CSV and TSV: a header, then "source target distance path" per answer with the path
+/// as vertices separated by spaces; distance and path are empty for unreachable targets.
+/// Binary: "JSP1", then per answer source, target, distance (LLONG_MAX if unreachable),
+/// vertex count and the vertices of the path, all as 64-bit integers of the host byte order.
+/// </summary>
+class ResultWriter {
+public:
+    ResultWriter(OutputFormat format, size_t threads) : format(format), threads(threads) {}
+
+    void Format(const std::vector<std::vector<lng>>& distances, const std::vector<std::vector<lng>>& paths,
+        const std::vector<Query>& queries, lng V);
+
+    bool Write(const std::string& path);
+
+    void Write(std::ostream& out) const;
+
+    size_t Bytes() const;
+
+private:
+    /// <summary>
+    /// Growable byte buffer without zero-filling the bytes it reserves
+    /// (new char[] leaves them uninitialized, std::vector::resize would not)
+    /// </summary>
+    struct Buffer {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        size_t capacity = 0;
+
+        char* Reserve(size_t bytes) {
+            if (size + bytes > capacity) {
+                capacity = std::max(2 * capacity, size + bytes);
+                std::unique_ptr<char[]> grown(new char[capacity]);
+                std::copy(data.get(), data.get() + size, grown.get());
+                data.swap(grown);
+            }
+            return data.get() + size;
+        }
+
+        void Append(const char* bytes, size_t count) {
+            std::copy(bytes, bytes + count, Reserve(count));
+            size += count;
+        }
+
+        void Number(lng value);
+    };
+
+    void FormatChunk(const std::vector<std::vector<lng>>& distances, const std::vector<std::vector<lng>>& paths,
+        const std::vector<Query>& queries, const std::vector<lng>& rows, lng begin, lng end, Buffer& out) const;
+
+    OutputFormat format;
+    size_t threads;
+    std::vector<Buffer> chunks; // header first, then the answers in query order
+};
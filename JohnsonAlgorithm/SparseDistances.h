@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#define lng long long
+
+/// <summary>
+/// All-pairs shortest paths stored only for reachable pairs.
+/// Sources of the same strongly connected component reach the same vertices,
+/// so they share one sorted column list and store rows aligned with it.
+/// </summary>
+struct SparseDistances {
+    /// <summary>
+    /// Component (block) of every vertex
+    /// </summary>
+    std::vector<lng> block;
+
+    /// <summary>
+    /// Sorted vertices reachable from each block
+    /// </summary>
+    std::vector<std::vector<lng>> columns;
+
+    /// <summary>
+    /// Distances and parents of every source, aligned with columns[block[src]]
+    /// </summary>
+    std::vector<std::vector<lng>> dist;
+    std::vector<std::vector<lng>> parent;
+
+    /// <summary>
+    /// Blocks containing a cycle with negative weight
+    /// </summary>
+    std::vector<lng> negativeCycleBlocks;
+
+    /// <summary>
+    /// Sources that reach a negative cycle have no distances
+    /// </summary>
+    std::vector<char> undefined;
+
+    bool Defined(lng src) const { return !undefined[src]; }
+
+    /// <summary>
+    /// Distance(weight) of the shortest path src -> dst, LLONG_MAX if there is none
+    /// </summary>
+    lng Get(lng src, lng dst) const {
+        lng i = Column(src, dst);
+        return i == -1 ? LLONG_MAX : dist[src][i];
+    }
+
+    /// <summary>
+    /// Previous vertex on the shortest path src -> dst, -1 if there is none
+    /// </summary>
+    lng Parent(lng src, lng dst) const {
+        lng i = Column(src, dst);
+        return i == -1 ? -1 : parent[src][i];
+    }
+
+    /// <summary>
+    /// Number of stored distances
+    /// </summary>
+    size_t Entries() const {
+        size_t count = 0;
+        for (const auto& row : dist)
+            count += row.size();
+        return count;
+    }
+
+private:
+    lng Column(lng src, lng dst) const {
+        if (undefined[src])
+            return -1;
+        const std::vector<lng>& cols = columns[block[src]];
+        auto it = std::lower_bound(cols.begin(), cols.end(), dst);
+        if (it == cols.end() || *it != dst)
+            return -1;
+        return it - cols.begin();
+    }
+};
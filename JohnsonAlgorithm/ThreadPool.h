@@ -1,20 +1,42 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Placement.h"
+#include "PoolMetrics.h"
+#include "Trace.h"
+
 /// <summary>
-/// Thread pool implementation
+/// Thread pool implementation. Every worker keeps its own metrics shard,
+/// Metrics() sums them into a snapshot. Pinned workers run on Placement::WorkerCpu.
 /// </summary>
 class ThreadPool 
 {
 public:
-    ThreadPool(size_t num_threads) : stop(false) 
+    ThreadPool(size_t num_threads, bool pin = false) : stop(false) 
     {
+        for (size_t i = 0; i < num_threads; ++i)
+            shards.emplace_back(new WorkerShard());
+
         for (size_t i = 0; i < num_threads; ++i) 
         {
-            workers.emplace_back([this] 
+            workers.emplace_back([this, i] 
                 {
+                WorkerShard& shard = *this->shards[i];
+                CurrentWorker() = (int)i;
                 while (true) 
                 {
-                    std::function<void()> task;
+                    QueuedTask task;
+                    auto idle_start = Clock::now();
                     {
                         std::unique_lock<std::mutex> lock(this->queue_mutex);
                         this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
@@ -23,12 +45,37 @@ public:
                         task = std::move(this->tasks.front());
                         this->tasks.pop();
                     }
-                    task();
+                    auto task_start = Clock::now();
+                    WorkerShard::Bump(shard.idleNanoseconds, Nanoseconds(idle_start, task_start));
+
+                    if (Trace::Enabled()) {
+                        lng begin = Trace::Now();
+                        task.run();
+                        Trace::Complete("task", begin, Trace::Now());
+                    }
+                    else
+                        task.run();
+
+                    shard.RecordTask(Nanoseconds(task.enqueued, task_start), Nanoseconds(task_start, Clock::now()));
                 }
                 });
+            if (pin)
+                Placement::Pin(workers.back(), Placement::WorkerCpu(i));
         }
     }
 
+    /// <summary>
+    /// Number of worker threads
+    /// </summary>
+    size_t Size() const { return workers.size(); }
+
+    /// <summary>
+    /// Index of the calling worker in its pool, -1 on a thread outside any pool.
+    /// Tasks of the same worker run one after another, so a task may update the
+    /// slot of its worker without synchronization.
+    /// </summary>
+    static int WorkerIndex() { return CurrentWorker(); }
+
     ~ThreadPool() 
     {
         {
@@ -49,20 +96,129 @@ public:
             std::bind(std::forward<F>(f), std::forward<Args>(args)...));
 
         std::future<return_type> res = task->get_future();
+        size_t depth;
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
             if (stop)
                 throw std::runtime_error("enqueue on stopped ThreadPool");
-            tasks.emplace([task]() { (*task)(); });
+            tasks.push({ [task]() { (*task)(); }, Clock::now() });
+            depth = Queued();
         }
         condition.notify_one();
+        if (Trace::Enabled())
+            Trace::Instant("enqueue", depth);
         return res;
     }
 
+    /// <summary>
+    /// Runs the task without a future, completion is signalled by the task itself (see Latch)
+    /// </summary>
+    void Submit(std::function<void()> task)
+    {
+        size_t depth;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (stop)
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+            tasks.push({ std::move(task), Clock::now() });
+            depth = Queued();
+        }
+        condition.notify_one();
+        if (Trace::Enabled())
+            Trace::Instant("enqueue", depth);
+    }
+
+    /// <summary>
+    /// Snapshot of the counters and histograms, can be taken while tasks run
+    /// </summary>
+    ThreadPoolMetrics Metrics()
+    {
+        ThreadPoolMetrics metrics;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            metrics.submitted = submitted;
+            metrics.queueDepth = tasks.size();
+            metrics.peakQueueDepth = peakQueueDepth;
+        }
+
+        for (const auto& shard : shards) {
+            metrics.completed += shard->completed.load(std::memory_order_relaxed);
+            metrics.idleMicroseconds.push_back(shard->idleNanoseconds.load(std::memory_order_relaxed) / 1000);
+            for (int b = 0; b < LatencyHistogram::BUCKETS; b++) {
+                metrics.queueWait.Add(b, shard->waitBuckets[b].load(std::memory_order_relaxed));
+                metrics.execution.Add(b, shard->executionBuckets[b].load(std::memory_order_relaxed));
+            }
+            metrics.queueWait.SetMax(shard->waitMax.load(std::memory_order_relaxed));
+            metrics.execution.SetMax(shard->executionMax.load(std::memory_order_relaxed));
+        }
+        return metrics;
+    }
+
 private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct QueuedTask {
+        std::function<void()> run;
+        Clock::time_point enqueued;
+    };
+
+    static int& CurrentWorker()
+    {
+        thread_local int index = -1;
+        return index;
+    }
+
+    static lng Nanoseconds(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+
+    /// <summary>
+    /// Counts a task just queued, the queue mutex must be held
+    /// </summary>
+    size_t Queued()
+    {
+        submitted++;
+        if ((lng)tasks.size() > peakQueueDepth)
+            peakQueueDepth = tasks.size();
+        return tasks.size();
+    }
+
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    std::vector<std::unique_ptr<WorkerShard>> shards;
+    std::queue<QueuedTask> tasks;
     std::mutex queue_mutex;
     std::condition_variable condition;
     bool stop;
-};
\ No newline at end of file
+    lng submitted = 0; // guarded by queue_mutex, like the depth
+    lng peakQueueDepth = 0;
+};
+
+/// <summary>
+/// Counter of unfinished tasks: each task counts down once, Wait blocks until zero.
+/// The count changes and the last notify happen under the mutex, so Wait cannot
+/// return, and its caller destroy the latch, while a worker still uses it.
+/// </summary>
+class Latch
+{
+public:
+    explicit Latch(size_t count) : count(count) {}
+
+    void CountDown()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--count == 0)
+            condition.notify_all();
+    }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return count == 0; });
+    }
+
+private:
+    size_t count; // guarded by mutex
+    std::mutex mutex;
+    std::condition_variable condition;
+};
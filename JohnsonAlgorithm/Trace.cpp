@@ -0,0 +1,131 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::enabled{ false };
+
+namespace {
+    struct TraceEvent {
+        const char* name;
+        char phase; // 'X' complete, 'i' instant
+        lng begin;
+        lng duration;
+        lng arg;
+    };
+
+    /// <summary>
+    /// Ring buffer of one thread, written only by its owner
+    /// </summary>
+    struct TraceBuffer {
+        static const size_t CAPACITY = 1 << 16;
+
+        explicit TraceBuffer(lng tid) : tid(tid), events(CAPACITY) {}
+
+        void Push(const TraceEvent& event) {
+            size_t n = head.load(std::memory_order_relaxed);
+            events[n % CAPACITY] = event;
+            head.store(n + 1, std::memory_order_release);
+        }
+
+        lng tid;
+        std::vector<TraceEvent> events;
+        std::atomic<size_t> head{ 0 };
+    };
+
+    /// <summary>
+    /// Buffers of all threads that recorded, they outlive the threads (pool workers
+    /// exit with their pool) until Write
+    /// </summary>
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<TraceBuffer>> registry;
+
+    const auto epoch = std::chrono::steady_clock::now();
+
+    TraceBuffer& ThreadBuffer() {
+        thread_local TraceBuffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.emplace_back(new TraceBuffer(registry.size() + 1));
+            buffer = registry.back().get();
+        }
+        return *buffer;
+    }
+}
+
+/// <summary>
+/// Microseconds since the start of the program
+/// </summary>
+lng Trace::Now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+/// <summary>
+/// Records a point event of the calling thread
+/// </summary>
+/// <param name="name">String literal</param>
+/// <param name="arg">Value shown with the event</param>
+void Trace::Instant(const char* name, lng arg)
+{
+    if (!Enabled())
+        return;
+    ThreadBuffer().Push({ name, 'i', Now(), 0, arg });
+}
+
+/// <summary>
+/// Records a span of the calling thread
+/// </summary>
+/// <param name="name">String literal</param>
+/// <param name="begin">Start, see Now</param>
+/// <param name="end">End, see Now</param>
+/// <param name="arg">Value shown with the event</param>
+void Trace::Complete(const char* name, lng begin, lng end, lng arg)
+{
+    if (!Enabled())
+        return;
+    ThreadBuffer().Push({ name, 'X', begin, end - begin, arg });
+}
+
+/// <summary>
+/// Writes the recorded events as a Chrome trace-event JSON object.
+/// Must not run while other threads record.
+/// </summary>
+/// <param name="out">Output stream</param>
+void Trace::Write(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    out << "{\"traceEvents\": [" << std::endl;
+    bool first = true;
+    for (const auto& buffer : registry) {
+        out << (first ? "" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+        first = false;
+
+        size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t count = head < TraceBuffer::CAPACITY ? head : TraceBuffer::CAPACITY;
+        for (size_t n = head - count; n < head; n++) {
+            const TraceEvent& event = buffer->events[n % TraceBuffer::CAPACITY];
+            out << ",\n  {\"name\": \"" << event.name << "\", \"ph\": \"" << event.phase << "\", \"ts\": " << event.begin;
+            if (event.phase == 'X')
+                out << ", \"dur\": " << event.duration;
+            else
+                out << ", \"s\": \"t\"";
+            out << ", \"pid\": 1, \"tid\": " << buffer->tid << ", \"args\": {\"value\": " << event.arg << "}}";
+        }
+    }
+    out << std::endl << "], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+/// <summary>
+/// Drops the recorded events, the buffers stay registered with their threads
+/// </summary>
+void Trace::Clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : registry)
+        buffer->head.store(0, std::memory_order_release);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+
+#define lng long long
+
+/// <summary>
+/// Timeline of the thread pool and the solver phases in Chrome trace-event format
+/// (chrome://tracing, Perfetto). Every thread records into its own ring buffer, so
+/// recording takes no lock; the oldest events of a full buffer are overwritten.
+/// While tracing is off every call site costs one branch on Enabled().
+/// Event names must be string literals, only the pointers are stored.
+/// </summary>
+class Trace {
+public:
+    static void Enable(bool on) { enabled.store(on, std::memory_order_relaxed); }
+
+    static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static lng Now();
+
+    static void Instant(const char* name, lng arg = 0);
+
+    static void Complete(const char* name, lng begin, lng end, lng arg = 0);
+
+    static void Write(std::ostream& out);
+
+    static void Clear();
+
+private:
+    static std::atomic<bool> enabled;
+};
@@ -0,0 +1,205 @@
+#include "VertexOrder.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/// <summary>
+/// Computes the permutation on the undirected version of the graph
+/// </summary>
+/// <param name="edges">Vector of edges</param>
+/// <param name="V">Number of vertices</param>
+/// <param name="ordering">Relabeling strategy</param>
+VertexOrder::VertexOrder(const std::vector<Edge>& edges, lng V, VertexOrdering ordering) : V(V)
+{
+    // undirected adjacency in CSR form, both directions of an edge are neighbours in memory
+    std::vector<lng> offset(V + 2, 0);
+    for (const Edge& edge : edges) {
+        offset[edge.from + 1]++;
+        offset[edge.to + 1]++;
+    }
+    for (lng v = 0; v <= V; v++)
+        offset[v + 1] += offset[v];
+    std::vector<lng> neighbours(offset[V + 1]);
+    {
+        std::vector<lng> pos(offset.begin(), offset.end() - 1);
+        for (const Edge& edge : edges) {
+            neighbours[pos[edge.from]++] = edge.to;
+            neighbours[pos[edge.to]++] = edge.from;
+        }
+    }
+    auto degree = [&](lng v) { return offset[v + 1] - offset[v]; };
+
+    // order[k] is the vertex that gets the id k + 1
+    std::vector<lng> order;
+    order.reserve(V);
+
+    if (ordering == VertexOrdering::Identity) {
+        for (lng v = 1; v <= V; v++)
+            order.push_back(v);
+    }
+    else if (ordering == VertexOrdering::Degree) {
+        for (lng v = 1; v <= V; v++)
+            order.push_back(v);
+        std::stable_sort(order.begin(), order.end(), [&](lng a, lng b) { return degree(a) > degree(b); });
+    }
+    else {
+        bool rcm = ordering == VertexOrdering::Rcm;
+
+        // Cuthill-McKee starts every component from a vertex of minimal degree
+        std::vector<lng> roots;
+        for (lng v = 1; v <= V; v++)
+            roots.push_back(v);
+        if (rcm)
+            std::stable_sort(roots.begin(), roots.end(), [&](lng a, lng b) { return degree(a) < degree(b); });
+
+        std::vector<char> visited(V + 1, 0);
+        std::vector<lng> next;
+        for (lng root : roots) {
+            if (visited[root])
+                continue;
+
+            visited[root] = 1;
+            size_t head = order.size();
+            order.push_back(root);
+            while (head < order.size()) {
+                lng f = order[head++];
+                next.clear();
+                for (lng i = offset[f]; i < offset[f + 1]; i++) {
+                    if (!visited[neighbours[i]]) {
+                        visited[neighbours[i]] = 1;
+                        next.push_back(neighbours[i]);
+                    }
+                }
+                if (rcm)
+                    std::stable_sort(next.begin(), next.end(), [&](lng a, lng b) { return degree(a) < degree(b); });
+                order.insert(order.end(), next.begin(), next.end());
+            }
+        }
+
+        if (rcm)
+            std::reverse(order.begin(), order.end());
+    }
+
+    newId.assign(V + 1, 0);
+    oldId.assign(V + 1, 0);
+    for (lng k = 0; k < V; k++) {
+        oldId[k + 1] = order[k];
+        newId[order[k]] = k + 1;
+    }
+}
+
+/// <summary>
+/// Edges in new ids, sorted by start vertex so adjacency rows are built in memory order
+/// </summary>
+/// <param name="edges">Vector of edges in input ids</param>
+/// <returns>Relabeled edges</returns>
+std::vector<Edge> VertexOrder::Relabel(const std::vector<Edge>& edges) const
+{
+    std::vector<Edge> relabeled;
+    relabeled.reserve(edges.size());
+    for (const Edge& edge : edges)
+        relabeled.push_back({ newId[edge.from], newId[edge.to], edge.weight });
+
+    std::stable_sort(relabeled.begin(), relabeled.end(), [](const Edge& a, const Edge& b) {
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+    return relabeled;
+}
+
+/// <summary>
+/// Per-vertex values (e.g. potentials) from input ids to new ids
+/// </summary>
+std::vector<lng> VertexOrder::Permute(const std::vector<lng>& values) const
+{
+    std::vector<lng> permuted(values.size());
+    for (lng v = 0; v < (lng)values.size(); v++)
+        permuted[newId[v]] = values[v];
+    return permuted;
+}
+
+/// <summary>
+/// Per-vertex values (e.g. potentials) from new ids back to input ids
+/// </summary>
+std::vector<lng> VertexOrder::Restore(const std::vector<lng>& values) const
+{
+    std::vector<lng> restored(values.size());
+    for (lng v = 0; v < (lng)values.size(); v++)
+        restored[oldId[v]] = values[v];
+    return restored;
+}
+
+/// <summary>
+/// Translates the result of Johnson back to input ids: rows, columns and parent vertices
+/// </summary>
+/// <param name="distances">Distances(weight) in new ids, replaced by the input ids version</param>
+/// <param name="paths">Pathes in new ids, replaced by the input ids version</param>
+void VertexOrder::Restore(std::vector<std::vector<lng>>& distances, std::vector<std::vector<lng>>& paths) const
+{
+    if (distances.empty())
+        return; // negative cycle, nothing to translate
+
+    std::vector<std::vector<lng>> oldDistances(V + 1), oldPaths(V + 1);
+    for (lng i = 0; i <= V; i++) {
+        lng src = oldId[i];
+        oldDistances[src] = Restore(distances[i]);
+
+        if (paths[i].empty())
+            continue;
+        std::vector<lng>& row = oldPaths[src];
+        row.assign(paths[i].size(), -1);
+        for (lng j = 0; j < (lng)paths[i].size(); j++)
+            row[oldId[j]] = paths[i][j] < 0 ? paths[i][j] : oldId[paths[i][j]];
+    }
+
+    distances.swap(oldDistances);
+    paths.swap(oldPaths);
+}
+
+/// <summary>
+/// Mean distance between the ids of the endpoints, a proxy for the cache lines
+/// touched by relaxations (dist[s] is read right after adj_list[f])
+/// </summary>
+/// <param name="edges">Vector of edges in input ids</param>
+/// <returns>Mean |NewId(from) - NewId(to)|</returns>
+double VertexOrder::EdgeSpan(const std::vector<Edge>& edges) const
+{
+    if (edges.empty())
+        return 0;
+
+    double span = 0;
+    for (const Edge& edge : edges)
+        span += std::llabs(newId[edge.from] - newId[edge.to]);
+    return span / edges.size();
+}
+
+/// <summary>
+/// Ordering from its command line name: identity, bfs, rcm or degree
+/// </summary>
+/// <returns>False for an unknown name</returns>
+bool VertexOrder::Parse(const std::string& name, VertexOrdering& ordering)
+{
+    for (VertexOrdering candidate : { VertexOrdering::Identity, VertexOrdering::Bfs, VertexOrdering::Rcm, VertexOrdering::Degree }) {
+        if (name == Name(candidate)) {
+            ordering = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// <summary>
+/// Command line name of the ordering
+/// </summary>
+const char* VertexOrder::Name(VertexOrdering ordering)
+{
+    switch (ordering) {
+    case VertexOrdering::Bfs:
+        return "bfs";
+    case VertexOrdering::Rcm:
+        return "rcm";
+    case VertexOrdering::Degree:
+        return "degree";
+    default:
+        return "identity";
+    }
+}
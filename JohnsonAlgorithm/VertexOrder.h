@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Edge.h"
+
+#define lng long long
+
+/// <summary>
+/// Relabeling strategies, all of them try to give neighbouring vertices close ids
+/// </summary>
+enum class VertexOrdering {
+    Identity,
+    Bfs,    // breadth-first order of the undirected graph
+    Rcm,    // reverse Cuthill-McKee, BFS from a low degree vertex with neighbours by degree
+    Degree  // decreasing degree, the most scanned rows are packed together
+};
+
+/// <summary>
+/// Permutation of the vertex ids 1..V, vertex 0 always keeps its id.
+/// Engines run on Relabel(edges), Restore translates their results back to the input ids.
+/// </summary>
+class VertexOrder
+{
+public:
+    VertexOrder(const std::vector<Edge>& edges, lng V, VertexOrdering ordering);
+
+    lng NewId(lng v) const { return newId[v]; }
+    lng OldId(lng v) const { return oldId[v]; }
+
+    std::vector<Edge> Relabel(const std::vector<Edge>& edges) const;
+
+    std::vector<lng> Permute(const std::vector<lng>& values) const;
+
+    std::vector<lng> Restore(const std::vector<lng>& values) const;
+
+    void Restore(std::vector<std::vector<lng>>& distances, std::vector<std::vector<lng>>& paths) const;
+
+    double EdgeSpan(const std::vector<Edge>& edges) const;
+
+    static bool Parse(const std::string& name, VertexOrdering& ordering);
+
+    static const char* Name(VertexOrdering ordering);
+
+private:
+    lng V;
+    std::vector<lng> newId;
+    std::vector<lng> oldId;
+};
@@ -1,116 +1,163 @@
-#include <stack>
+#include <chrono>
+#include <fstream>
+#include <iostream>
 #include "GraphMT.h"
-#include "GraphS.h"
 #include "Edge.h"
 #include "GenerateFile.h"
+#include "Benchmark.h"
+#include "CommandLine.h"
+#include "ResultWriter.h"
+#include "VertexOrder.h"
+#include "Trace.h"
+
+/// <summary>
+/// Runs one engine on a graph file and writes the answers of a batch of queries.
+/// Diagnostics go to the standard error, so the standard output carries only results.
+/// Exit codes: 0 done, 1 invalid options or input, 2 negative cycle.
+/// </summary>
+int main(int argc, char* argv[]) {
+    CommandLine options;
+    std::string error;
+    if (!CommandLine::Parse(argc, argv, options, error)) {
+        std::cerr << error << std::endl;
+        CommandLine::PrintUsage(std::cerr);
+        return 1;
+    }
+    if (options.help) {
+        CommandLine::PrintUsage(std::cout);
+        return 0;
+    }
 
-int main() {
-    generateFile();
+    if (options.generate)
+        generateFile();
 
-    // Open the input file
-    std::ifstream inputFile("input.txt");
+    std::ifstream inputFile(options.input);
     if (!inputFile.is_open()) {
-        std::cout << "Failed to open input file." << std::endl;
+        std::cerr << "Failed to open input file " << options.input << "." << std::endl;
         return 1;
     }
 
-    inputFile.seekg(0);
-
-    int V, E, from, to, weight;
-
-    // Read the number of vertices and edges
-    inputFile >> V >> E;
-
-    /*
-        vector to store edges
-        edge - (from->to)
-        weight - weight
-        edges.push_back({from, to, weight})
-    */
+    lng V;
     std::vector<Edge> edges;
-
-    // Read the edges from the file
-    for (int i = 0; i < E; ++i) {
-        inputFile >> from >> to >> weight;
-        edges.push_back({ from, to, weight });
+    if (!ReadGraph(inputFile, options.inputFormat, edges, V, error)) {
+        std::cerr << options.input << ": " << error << std::endl;
+        return 1;
+    }
+    inputFile.close();
+    lng E = edges.size();
+
+    // every source and target unless a query file narrows them
+    std::vector<Query> queries;
+    if (options.queries.empty()) {
+        for (lng src = 1; src <= V; src++)
+            queries.push_back({ src, 0 });
+    }
+    else {
+        std::ifstream queryFile(options.queries);
+        if (!queryFile.is_open()) {
+            std::cerr << "Failed to open query file " << options.queries << "." << std::endl;
+            return 1;
+        }
+        if (!ReadQueries(queryFile, V, queries, error)) {
+            std::cerr << options.queries << ": " << error << std::endl;
+            return 1;
+        }
     }
 
-    inputFile.close(); // Close the input file
-
-    // Create instances of both realizations
-    GraphS oldGraph(edges, V);
-    GraphMT newGraph(edges, V, 4);
-
-    // Print the graph
-    //cout << "Graph:" << endl;
-    //oldGraph.print_graph();
-
-    // shortest paths
-    std::vector<std::vector<lng>> oldPaths(V + 1), newPaths(V + 1);
-
-    // weight of shortest paths
-    std::vector<std::vector<lng>> oldDistances = oldGraph.Johnson(E, oldPaths);
-    std::vector<std::vector<lng>> newDistances = newGraph.Johnson(E, newPaths);
-
-    // if graph has negative cycle
-    if (oldDistances.empty() || newDistances.empty()) {
-        std::cout << "The graph contains a cycle with negative weight." << std::endl;
+    Trace::Enable(!options.tracePath.empty());
+    PerfScope::Enable(options.perf);
+    Placement::EnableHugePages(options.hugePages);
+    auto writeTrace = [&]() {
+        if (options.tracePath.empty())
+            return;
+        std::ofstream traceFile(options.tracePath);
+        Trace::Write(traceFile);
+    };
+
+    // compare the engines instead of a run
+    if (options.bench) {
+        std::vector<BenchmarkResult> benchmark = RunBenchmark(edges, V, options.threads, options.batch > 1 ? options.batch : 4);
+        if (options.json)
+            PrintBenchmarkJson(benchmark, std::cout);
+        else
+            PrintBenchmark(benchmark, std::cout);
+        writeTrace();
         return 0;
     }
 
-    int choice;
-    bool exitProgram = false;
-
-    while (!exitProgram) {
-        std::cout << "Choose the realization to display the shortest paths (1 for old, 2 for new, 0 to exit): ";
-        std::cin >> choice;
-
-        if (choice == 0) {
-            exitProgram = true;
-            continue;
+    // optional relabeling for cache locality, the results keep the ids of the input
+    VertexOrder order(edges, V, options.ordering);
+    std::vector<Edge> relabeled = options.ordering == VertexOrdering::Identity ? edges : order.Relabel(edges);
+    std::unique_ptr<Graph> graph = MakeEngine(options, relabeled, V);
+
+    // distinct sources of the queries, in the ids of the engine
+    std::vector<lng> sources;
+    std::vector<char> asked(V + 1, 0);
+    for (const Query& query : queries) {
+        lng src = order.NewId(query.first);
+        if (!asked[src]) {
+            asked[src] = 1;
+            sources.push_back(src);
         }
+    }
 
-        bool exitRealization = false;
-
-        while (!exitRealization) {
-            std::cout << "Enter the vertex number to display the shortest paths (0 to go back): ";
-            int src;
-            std::cin >> src;
-            if (src == 0) {
-                exitRealization = true;
-                continue;
-            }
-            if (src <= 0 || src > V) std::cout << "Invalid vertex number." << std::endl;
-            else {
-                std::vector<std::vector<lng>>& distances = (choice == 1) ? oldDistances : newDistances;
-                std::vector<std::vector<lng>>& paths = (choice == 1) ? oldPaths : newPaths;
-
-                for (int i = 1; i <= V; ++i) {
-                    if (distances[src][i] == LLONG_MAX)
-                        std::cout << "The path to the vertex " << i << " does not exist." << std::endl;
-                    else {
-                        std::cout << src << " <-> " << i << " weight: " << distances[src][i] << " path: ";
-                        // print the shortest path vertices
-                        std::stack<lng> path;
-                        int v = i;
-                        while (v != src) {
-                            path.push(v);
-                            v = paths[src][v];
-                        }
-                        path.push(src);
-
-                        while (!path.empty()) {
-                            std::cout << path.top();
-                            path.pop();
-                            if (!path.empty()) std::cout << "->";
-                        }
-                        std::cout << std::endl;
-                    }
-                }
+    // all pairs only for a full batch, otherwise the rows of the asked sources
+    std::vector<std::vector<lng>> distances(V + 1), paths(V + 1);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    if ((lng)sources.size() == V)
+        distances = graph->Johnson(E, paths);
+    else if (GraphMT* multithreaded = dynamic_cast<GraphMT*>(graph.get())) {
+        std::vector<std::vector<lng>> parents;
+        std::vector<std::vector<lng>> rows = multithreaded->ShortestPathsFrom(sources, parents);
+        if (rows.empty())
+            distances.clear();
+        for (size_t i = 0; i < rows.size(); i++) {
+            distances[sources[i]].swap(rows[i]);
+            paths[sources[i]].swap(parents[i]);
+        }
+    }
+    else {
+        for (lng src : sources) {
+            distances[src] = graph->ShortestPaths(src, paths[src]);
+            if (distances[src].empty()) {
+                distances.clear();
+                break;
             }
-            std::cout << std::endl;
         }
     }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    lng microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+    std::cerr << "Execution time (" << options.engine << "): " << microseconds << " microseconds" << std::endl;
+    writeTrace();
+
+    if (!options.statsPath.empty()) {
+        BenchmarkResult run;
+        run.engine = options.engine;
+        run.microseconds = microseconds;
+        run.relaxations = graph->Relaxations();
+        run.matches = true;
+        run.edgeSpan = order.EdgeSpan(edges);
+        run.imbalance = 0;
+        run.stats = graph->Stats();
+        if (GraphMT* multithreaded = dynamic_cast<GraphMT*>(graph.get()))
+            run.pool = multithreaded->PoolMetrics();
+        std::ofstream statsFile(options.statsPath);
+        PrintBenchmarkJson({ run }, statsFile);
+    }
+
+    if (distances.empty()) {
+        std::cerr << "The graph contains a cycle with negative weight." << std::endl;
+        return 2;
+    }
+    order.Restore(distances, paths);
 
+    if (options.output == OutputFormat::None)
+        return 0;
+    ResultWriter writer(options.output, options.threads);
+    writer.Format(distances, paths, queries, V);
+    if (!writer.Write(options.outputPath)) {
+        std::cerr << "Failed to write " << (options.outputPath.empty() ? "the results" : options.outputPath) << "." << std::endl;
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
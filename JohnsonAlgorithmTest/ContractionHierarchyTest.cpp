@@ -0,0 +1,79 @@
+#include "pch.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <vector>
+#include "..\JohnsonAlgorithm\Edge.h"
+#include "..\JohnsonAlgorithm\GraphS.h"
+#include "..\JohnsonAlgorithm\ContractionHierarchy.h"
+
+
+TEST(ContractionHierarchyTest, SmallGraph)
+{
+    int V = 4;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 3 });
+    edges.push_back({ 2, 3, 4 });
+    edges.push_back({ 1, 3, 10 });
+    edges.push_back({ 3, 4, 1 });
+
+    ContractionHierarchy ch(edges, V);
+
+    std::vector<lng> path;
+    EXPECT_EQ(ch.Query(1, 4, path), 8);
+    EXPECT_EQ(path, std::vector<lng>({ 1, 2, 3, 4 }));
+
+    EXPECT_EQ(ch.Query(4, 1, path), LLONG_MAX);
+    EXPECT_TRUE(path.empty());
+
+    EXPECT_EQ(ch.Query(2, 2, path), 0);
+}
+
+TEST(ContractionHierarchyTest, MatchesJohnson)
+{
+    int V = 60, E = 300;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> dis_vertex(1, V);
+    std::uniform_int_distribution<> dis_weight(1, 20);
+
+    std::vector<Edge> edges;
+    for (int i = 0; i < E; ++i)
+        edges.push_back({ dis_vertex(gen), dis_vertex(gen), dis_weight(gen) });
+
+    GraphS graphS(edges, V);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graphS.Johnson(E, paths);
+
+    ContractionHierarchy ch(edges, V);
+    std::string file = (std::filesystem::temp_directory_path() / "ch_test.bin").string();
+    ASSERT_TRUE(ch.Save(file));
+    ContractionHierarchy loaded;
+    bool read = loaded.Load(file);
+    std::remove(file.c_str());
+    ASSERT_TRUE(read);
+
+    std::vector<lng> path;
+    for (int s = 1; s <= V; ++s) {
+        for (int t = 1; t <= V; ++t) {
+            lng dist = loaded.Query(s, t, path);
+            EXPECT_EQ(dist, distances[s][t]);
+            if (dist == LLONG_MAX)
+                continue;
+
+            // the unpacked path must consist of original edges with the same total weight
+            ASSERT_EQ(path.front(), s);
+            ASSERT_EQ(path.back(), t);
+            lng total = 0;
+            for (size_t i = 1; i < path.size(); ++i) {
+                lng best = LLONG_MAX;
+                for (const Edge& edge : edges)
+                    if (edge.from == path[i - 1] && edge.to == path[i])
+                        best = std::min(best, edge.weight);
+                ASSERT_NE(best, LLONG_MAX);
+                total += best;
+            }
+            EXPECT_EQ(total, dist);
+        }
+    }
+}
@@ -1,9 +1,15 @@
 #include "pch.h"
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include "..\JohnsonAlgorithm\Edge.h"
 #include "..\JohnsonAlgorithm\GraphS.h"
 #include "..\JohnsonAlgorithm\GraphMT.h"
+#include "..\JohnsonAlgorithm\GraphHP.h"
+#include "..\JohnsonAlgorithm\GraphDynamic.h"
+#include "..\JohnsonAlgorithm\GraphReduced.h"
+#include "..\JohnsonAlgorithm\GraphBFS.h"
+#include "..\JohnsonAlgorithm\VertexOrder.h"
 
 
 TEST(GraphSJohnsonAlgorithmTest, NotNegativeCycle)
@@ -107,4 +113,741 @@ TEST(GraphMTJohnsonAlgorithmTest, NegativeCycle)
 
     // if graph has negative cycle
     EXPECT_TRUE(distances.empty());
-}
\ No newline at end of file
+}
+
+TEST(GraphSJohnsonSparseTest, MatchesDense)
+{
+    int V = 6, E = 6;
+    std::vector<Edge> edges;
+
+    // component {1, 2, 3} -> 4 -> 5, vertex 6 is isolated
+    edges.push_back({ 1, 2, 2 });
+    edges.push_back({ 2, 3, 2 });
+    edges.push_back({ 3, 1, 2 });
+    edges.push_back({ 3, 4, 5 });
+    edges.push_back({ 4, 5, 1 });
+    edges.push_back({ 1, 4, 9 });
+
+    GraphS graphS(edges, V);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graphS.Johnson(E, paths);
+
+    GraphS sparseGraph(edges, V);
+    SparseDistances sparse = sparseGraph.JohnsonSparse();
+
+    EXPECT_TRUE(sparse.negativeCycleBlocks.empty());
+    for (int s = 1; s <= V; ++s)
+        for (int t = 1; t <= V; ++t)
+            EXPECT_EQ(sparse.Get(s, t), distances[s][t]);
+
+    // sources 1..3 share one column list, unreachable pairs are not stored
+    EXPECT_EQ(sparse.Entries(), 3 * 5 + 2 + 1 + 1);
+    EXPECT_EQ(sparse.Parent(1, 5), 4);
+}
+
+TEST(GraphMTJohnsonSparseTest, NegativeCycleIsLocal)
+{
+    int V = 5;
+    std::vector<Edge> edges;
+
+    // negative cycle 1 <-> 2 feeding 3, independent part 4 -> 5 -> 3 with a negative edge
+    edges.push_back({ 1, 2, 1 });
+    edges.push_back({ 2, 1, -3 });
+    edges.push_back({ 2, 3, 1 });
+    edges.push_back({ 4, 5, -2 });
+    edges.push_back({ 5, 3, 4 });
+
+    GraphMT graphMT(edges, V, 4);
+    SparseDistances sparse = graphMT.JohnsonSparse();
+
+    ASSERT_EQ(sparse.negativeCycleBlocks.size(), 1);
+    EXPECT_FALSE(sparse.Defined(1));
+    EXPECT_FALSE(sparse.Defined(2));
+
+    EXPECT_TRUE(sparse.Defined(4));
+    EXPECT_EQ(sparse.Get(4, 5), -2);
+    EXPECT_EQ(sparse.Get(4, 3), 2);
+    EXPECT_EQ(sparse.Get(4, 1), LLONG_MAX);
+    EXPECT_EQ(sparse.Get(3, 3), 0);
+}
+
+TEST(GraphDagTest, NegativeWeights)
+{
+    int V = 4, E = 4;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 5 });
+    edges.push_back({ 1, 3, 2 });
+    edges.push_back({ 3, 2, -4 });
+    edges.push_back({ 2, 4, -1 });
+
+    GraphS graphS(edges, V);
+    GraphMT graphMT(edges, V, 4);
+    EXPECT_TRUE(graphS.IsAcyclic());
+
+    std::vector<std::vector<lng>> pathsS(V + 1), pathsMT(V + 1);
+    std::vector<std::vector<lng>> distancesS = graphS.Johnson(E, pathsS);
+    std::vector<std::vector<lng>> distancesMT = graphMT.Johnson(E, pathsMT);
+
+    EXPECT_EQ(distancesS, distancesMT);
+    EXPECT_EQ(pathsS, pathsMT);
+
+    EXPECT_EQ(distancesS[1][2], -2);
+    EXPECT_EQ(distancesS[1][4], -3);
+    EXPECT_EQ(distancesS[3][4], -5);
+    EXPECT_EQ(distancesS[4][1], LLONG_MAX);
+    EXPECT_EQ(pathsS[1][2], 3);
+    EXPECT_EQ(pathsS[1][4], 2);
+}
+
+TEST(GraphHPJohnsonAlgorithmTest, MatchesGraphS)
+{
+    int V = 4, E = 6;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 4 });
+    edges.push_back({ 1, 3, 1 });
+    edges.push_back({ 3, 2, 2 });
+    edges.push_back({ 2, 4, 1 });
+    edges.push_back({ 4, 1, 3 });
+    edges.push_back({ 3, 4, 5 });
+
+    GraphS graphS(edges, V);
+    GraphHP graphHP(edges, V);
+
+    std::vector<std::vector<lng>> pathsS(V + 1), pathsHP(V + 1);
+    std::vector<std::vector<lng>> distancesS = graphS.Johnson(E, pathsS);
+    std::vector<std::vector<lng>> distancesHP = graphHP.Johnson(E, pathsHP);
+
+    EXPECT_EQ(distancesS, distancesHP);
+    EXPECT_EQ(distancesHP[1][4], 4);
+    EXPECT_EQ(pathsHP[1][4], 2);
+    EXPECT_EQ(pathsHP[1][2], 3);
+
+    // edges 1 -> 2 and 3 -> 4 are never shortest paths, so they are relaxed less often
+    EXPECT_LT(graphHP.Relaxations(), graphS.Relaxations());
+}
+
+TEST(GraphDynamicTest, UpdatesAndInsertions)
+{
+    int V = 4, E = 3;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 5 });
+    edges.push_back({ 2, 3, 5 });
+    edges.push_back({ 3, 4, 5 });
+
+    GraphDynamic graph(edges, V);
+    std::vector<std::vector<lng>> paths(V + 1);
+    graph.Johnson(E, paths);
+
+    // a shortcut 1 -> 3 improves only row 1
+    EXPECT_EQ(graph.InsertEdge(1, 3, 2), 1);
+    EXPECT_EQ(graph.Distances()[1][4], 7);
+    EXPECT_EQ(graph.Parents()[1][4], 3);
+    EXPECT_EQ(graph.Distances()[2][4], 10);
+
+    // a negative edge 4 -> 2 is fine, 4 -> 1 with -20 would close a negative cycle
+    EXPECT_EQ(graph.InsertEdge(4, 2, -3), 3);
+    EXPECT_EQ(graph.Distances()[4][3], 2);
+    EXPECT_EQ(graph.Distances()[3][2], 2);
+    EXPECT_EQ(graph.InsertEdge(4, 1, -20), -1);
+
+    // making 3 -> 4 heavier recomputes the rows whose trees used it
+    EXPECT_EQ(graph.UpdateEdge(3, 4, 8), 3);
+    EXPECT_EQ(graph.Distances()[1][4], 10);
+    EXPECT_EQ(graph.Distances()[4][3], 2);
+    EXPECT_EQ(graph.Distances()[2][1], LLONG_MAX);
+}
+
+TEST(GraphPotentialsTest, RepairedByEdgeChanges)
+{
+    int V = 4, E = 3;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 4 });
+    edges.push_back({ 2, 3, 1 });
+    edges.push_back({ 3, 4, 2 });
+
+    GraphS graph(edges, V);
+    EXPECT_FALSE(graph.HasNegativeCycle());
+
+    // every edge keeps a non-negative reduced weight after the local repairs
+    EXPECT_TRUE(graph.InsertEdge(4, 2, -3));
+    EXPECT_TRUE(graph.UpdateEdge(1, 2, -1));
+    EXPECT_FALSE(graph.InsertEdge(3, 2, -2));
+    EXPECT_FALSE(graph.HasNegativeCycle());
+
+    const std::vector<lng>& h = graph.Potentials();
+    std::vector<Edge> current = { { 1, 2, -1 }, { 2, 3, 1 }, { 3, 4, 2 }, { 4, 2, -3 } };
+    for (const Edge& edge : current)
+        EXPECT_GE(edge.weight + h[edge.from] - h[edge.to], 0);
+
+    std::vector<lng> parent;
+    std::vector<lng> dist = graph.ShortestPaths(1, parent);
+    EXPECT_EQ(dist[4], 2);
+    EXPECT_EQ(dist[2], -1);
+    EXPECT_EQ(parent[4], 3);
+
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E + 1, paths);
+    EXPECT_EQ(distances[4][3], -2);
+}
+
+TEST(VertexOrderTest, RelabeledJohnsonMatches)
+{
+    int V = 6, E = 7;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 6, 1, 2 });
+    edges.push_back({ 1, 5, 3 });
+    edges.push_back({ 5, 2, -1 });
+    edges.push_back({ 2, 4, 4 });
+    edges.push_back({ 4, 3, 1 });
+    edges.push_back({ 3, 6, 2 });
+    edges.push_back({ 6, 4, 9 });
+
+    GraphS graph(edges, V);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    for (VertexOrdering ordering : { VertexOrdering::Bfs, VertexOrdering::Rcm, VertexOrdering::Degree }) {
+        VertexOrder order(edges, V, ordering);
+        for (int v = 1; v <= V; v++)
+            EXPECT_EQ(order.OldId(order.NewId(v)), v);
+
+        std::vector<Edge> relabeled = order.Relabel(edges);
+        GraphS reordered(relabeled, V);
+        std::vector<std::vector<lng>> reorderedPaths(V + 1);
+        std::vector<std::vector<lng>> reorderedDistances = reordered.Johnson(E, reorderedPaths);
+        order.Restore(reorderedDistances, reorderedPaths);
+
+        EXPECT_EQ(reorderedDistances, distances);
+        EXPECT_EQ(reorderedPaths[6][2], 5);
+        EXPECT_EQ(reorderedPaths[6][6], 6);
+    }
+
+    // the ring 6 -> 1 -> 5 -> 2 -> 4 -> 3 -> 6 gets consecutive ids
+    VertexOrder rcm(edges, V, VertexOrdering::Rcm);
+    EXPECT_LT(rcm.EdgeSpan(edges), VertexOrder(edges, V, VertexOrdering::Identity).EdgeSpan(edges));
+}
+
+TEST(GraphReducedTest, ChainsAndPendants)
+{
+    int V = 7, E = 9;
+    std::vector<Edge> edges;
+
+    // triangle 1, 2, 3 with the chain 3 - 4 - 5 back to 1 and the pendants 6 and 7
+    edges.push_back({ 1, 2, 2 });
+    edges.push_back({ 2, 3, 2 });
+    edges.push_back({ 3, 1, 3 });
+    edges.push_back({ 3, 4, -1 });
+    edges.push_back({ 4, 5, 2 });
+    edges.push_back({ 5, 4, 1 });
+    edges.push_back({ 5, 1, 1 });
+    edges.push_back({ 2, 6, 4 });
+    edges.push_back({ 7, 5, -2 });
+
+    GraphS graphS(edges, V);
+    GraphReduced graph(edges, V, 2);
+
+    std::vector<std::vector<lng>> pathsS(V + 1), paths(V + 1);
+    std::vector<std::vector<lng>> distancesS = graphS.Johnson(E, pathsS);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    EXPECT_EQ(distances, distancesS);
+    EXPECT_LT(graph.KernelVertices(), V);
+
+    // 7 -> 5 -> 1 -> 2 -> 6, the path goes through removed vertices
+    EXPECT_EQ(distances[7][6], 5);
+    EXPECT_EQ(paths[7][6], 2);
+    EXPECT_EQ(paths[7][2], 1);
+    EXPECT_EQ(paths[7][1], 5);
+    EXPECT_EQ(paths[7][5], 7);
+
+    // 1 -> 2 -> 3 -> 4 -> 5 uses the contracted chain
+    EXPECT_EQ(distances[1][5], 5);
+    EXPECT_EQ(paths[1][5], 4);
+    EXPECT_EQ(paths[1][4], 3);
+}
+
+TEST(GraphReducedTest, NegativeCycleOnChain)
+{
+    int V = 4, E = 5;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 1 });
+    edges.push_back({ 2, 3, 1 });
+    edges.push_back({ 3, 1, 1 });
+    edges.push_back({ 3, 4, -2 });
+    edges.push_back({ 4, 3, 1 });
+
+    GraphReduced graph(edges, V, 2);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    EXPECT_TRUE(distances.empty());
+}
+
+TEST(GraphMTJohnsonAlgorithmTest, BatchedSources)
+{
+    int V = 7, E = 10;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 4 });
+    edges.push_back({ 2, 3, -2 });
+    edges.push_back({ 3, 1, 3 });
+    edges.push_back({ 3, 4, 2 });
+    edges.push_back({ 4, 5, 1 });
+    edges.push_back({ 5, 3, 0 });
+    edges.push_back({ 5, 6, 7 });
+    edges.push_back({ 6, 7, -1 });
+    edges.push_back({ 7, 6, 2 });
+    edges.push_back({ 1, 6, 9 });
+
+    GraphMT graph(edges, V, 2);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    // batches of 3 leave a last batch with one source
+    GraphMT batched(edges, V, 2, 3);
+    std::vector<std::vector<lng>> batchedPaths(V + 1);
+    std::vector<std::vector<lng>> batchedDistances = batched.Johnson(E, batchedPaths);
+
+    EXPECT_EQ(batchedDistances, distances);
+    EXPECT_EQ(batchedDistances[1][7], 8);
+    EXPECT_EQ(batchedPaths[1][7], 6);
+    EXPECT_EQ(batchedPaths[1][6], 1);
+    EXPECT_EQ(batchedPaths[2][1], 3);
+}
+
+TEST(GraphBFSTest, UnitAndSmallWeights)
+{
+    int V = 6, E = 8;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 1 });
+    edges.push_back({ 2, 3, 1 });
+    edges.push_back({ 3, 4, 1 });
+    edges.push_back({ 1, 5, 1 });
+    edges.push_back({ 5, 4, 1 });
+    edges.push_back({ 4, 1, 1 });
+    edges.push_back({ 6, 5, 1 });
+    edges.push_back({ 3, 6, 1 });
+
+    GraphS graphS(edges, V);
+    GraphBFS graph(edges, V);
+    std::vector<std::vector<lng>> pathsS(V + 1), paths(V + 1);
+    std::vector<std::vector<lng>> distancesS = graphS.Johnson(E, pathsS);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    EXPECT_EQ(distances, distancesS);
+    EXPECT_EQ(distances[1][4], 2);
+    EXPECT_EQ(paths[1][4], 5);
+    EXPECT_EQ(distances[2][6], 2);
+
+    // weights 0..3 use the buckets, 2 -> 3 -> 6 -> 5 -> 4 is cheaper than 2 -> 3 -> 4
+    edges[2].weight = 3;
+    edges[7].weight = 0;
+    edges[6].weight = 0;
+    edges[3].weight = 2;
+    GraphS weightedS(edges, V);
+    GraphBFS weighted(edges, V);
+    distancesS = weightedS.Johnson(E, pathsS);
+    distances = weighted.Johnson(E, paths);
+
+    EXPECT_EQ(distances, distancesS);
+    EXPECT_EQ(distances[2][4], 2);
+    EXPECT_EQ(paths[2][4], 5);
+    EXPECT_EQ(paths[2][5], 6);
+    EXPECT_EQ(paths[2][6], 3);
+}
+
+TEST(GraphMTDeltaSteppingTest, MatchesDijkstra)
+{
+    int V = 6;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 7 });
+    edges.push_back({ 1, 3, 2 });
+    edges.push_back({ 3, 2, 3 });
+    edges.push_back({ 2, 4, -2 });
+    edges.push_back({ 3, 5, 10 });
+    edges.push_back({ 4, 5, 1 });
+    edges.push_back({ 5, 6, 4 });
+    edges.push_back({ 6, 1, 1 });
+
+    GraphMT graph(edges, V, 4);
+
+    // a small delta makes the light/heavy split matter
+    std::vector<lng> parent;
+    std::vector<lng> dist = graph.DeltaStepping(1, parent, 2);
+    EXPECT_EQ(dist, std::vector<lng>({ LLONG_MAX, 0, 5, 2, 3, 4, 8 }));
+    EXPECT_EQ(parent[5], 4);
+    EXPECT_EQ(parent[2], 3);
+
+    // fewer sources than workers use delta-stepping, more use one Dijkstra per source
+    for (std::vector<lng> sources : { std::vector<lng>({ 2, 6 }), std::vector<lng>({ 1, 2, 3, 4, 5, 6 }) }) {
+        std::vector<std::vector<lng>> parents;
+        std::vector<std::vector<lng>> rows = graph.ShortestPathsFrom(sources, parents);
+        ASSERT_EQ(rows.size(), sources.size());
+        for (size_t i = 0; i < sources.size(); i++) {
+            std::vector<lng> expectedParent;
+            EXPECT_EQ(rows[i], graph.ShortestPaths(sources[i], expectedParent));
+        }
+    }
+}
+
+TEST(GraphMTDeltaSteppingTest, SkipsEmptyBuckets)
+{
+    // every step crosses 100000 empty buckets of width 1
+    int V = 20;
+    std::vector<Edge> edges;
+    for (int i = 1; i < V; i++)
+        edges.push_back({ i, i + 1, 100000 });
+    edges.push_back({ 1, V, 3000000 });
+
+    GraphMT graph(edges, V, 2);
+    std::vector<lng> parent;
+    std::vector<lng> dist = graph.DeltaStepping(1, parent, 1);
+
+    for (int v = 1; v <= V; v++)
+        EXPECT_EQ(dist[v], (v - 1) * 100000LL);
+    EXPECT_EQ(parent[V], V - 1);
+}
+
+TEST(GraphMTJohnsonAlgorithmTest, CostOrderedSchedule)
+{
+    int V = 8, E = 9;
+    std::vector<Edge> edges;
+
+    // cycle 1 -> 2 -> 3 -> 1 reaches the chain 4 -> ... -> 8, the chain vertices are cheap sources
+    edges.push_back({ 1, 2, 1 });
+    edges.push_back({ 2, 3, 1 });
+    edges.push_back({ 3, 1, -1 });
+    edges.push_back({ 3, 4, 2 });
+    edges.push_back({ 4, 5, 2 });
+    edges.push_back({ 5, 6, -3 });
+    edges.push_back({ 6, 7, 2 });
+    edges.push_back({ 7, 8, 2 });
+    edges.push_back({ 1, 8, 9 });
+
+    GraphS graphS(edges, V);
+    GraphMT graph(edges, V, 3);
+
+    std::vector<std::vector<lng>> pathsS(V + 1), paths(V + 1);
+    std::vector<std::vector<lng>> distancesS = graphS.Johnson(E, pathsS);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    EXPECT_EQ(distances, distancesS);
+    EXPECT_EQ(paths, pathsS);
+    EXPECT_EQ(distances[1][8], 7);
+    EXPECT_EQ(graph.WorkerBusyTime().size(), 3);
+}
+
+TEST(GraphMTJohnsonAlgorithmTest, ParallelPhases)
+{
+    int V = 7, E = 8;
+    std::vector<Edge> edges;
+
+    // more vertices than workers, so every phase splits them into several ranges
+    edges.push_back({ 1, 2, 4 });
+    edges.push_back({ 2, 3, -2 });
+    edges.push_back({ 3, 1, 1 });
+    edges.push_back({ 3, 4, 3 });
+    edges.push_back({ 4, 5, -1 });
+    edges.push_back({ 5, 6, 2 });
+    edges.push_back({ 6, 4, 0 });
+    edges.push_back({ 7, 1, -5 });
+
+    GraphS graphS(edges, V);
+    GraphMT graph(edges, V, 3);
+
+    std::vector<std::vector<lng>> pathsS(V + 1), paths(V + 1);
+    std::vector<std::vector<lng>> distancesS = graphS.Johnson(E, pathsS);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    EXPECT_EQ(distances, distancesS);
+    EXPECT_EQ(paths, pathsS);
+
+#if JOHNSON_STATS
+    std::vector<std::string> names;
+    for (const auto& time : graph.Stats().phases)
+        names.push_back(time.first);
+    EXPECT_EQ(names, std::vector<std::string>({ "load", "output", "bellman-ford", "cycle check", "reweight", "dijkstra" }));
+#endif
+
+    // the parallel cycle check finds the violated arc of a new negative cycle
+    edges.push_back({ 4, 3, -4 });
+    GraphMT negative(edges, V, 3);
+    std::vector<std::vector<lng>> pathsN(V + 1);
+    EXPECT_TRUE(negative.Johnson(E + 1, pathsN).empty());
+}
+
+TEST(GraphJohnsonAlgorithmTest, WideReducedWeights)
+{
+    int V = 5, E = 7;
+    std::vector<Edge> edges;
+
+    // reduced weights above 16 bits, then above 32 bits, mixed with negative edges
+    edges.push_back({ 1, 2, 70000 });
+    edges.push_back({ 2, 3, -5 });
+    edges.push_back({ 3, 1, 2 });
+    edges.push_back({ 3, 4, 10000000000LL });
+    edges.push_back({ 4, 5, -3 });
+    edges.push_back({ 5, 3, 1 });
+    edges.push_back({ 1, 5, 3 });
+
+    for (lng limit : { 65536LL, 10000000000LL }) {
+        std::vector<Edge> chosen;
+        for (const Edge& edge : edges)
+            if (edge.weight < limit)
+                chosen.push_back(edge);
+
+        GraphS graphS(chosen, V);
+        GraphMT graphMT(chosen, V, 2);
+        std::vector<std::vector<lng>> pathsS(V + 1), pathsMT(V + 1);
+        std::vector<std::vector<lng>> distancesS = graphS.Johnson(chosen.size(), pathsS);
+        std::vector<std::vector<lng>> distancesMT = graphMT.Johnson(chosen.size(), pathsMT);
+
+        EXPECT_EQ(distancesS, distancesMT);
+        EXPECT_EQ(pathsS, pathsMT);
+        for (lng src = 1; src <= V; src++) {
+            std::vector<lng> parent;
+            EXPECT_EQ(graphS.ShortestPaths(src, parent), distancesS[src]);
+        }
+
+        // a second run sees the same weights
+        std::vector<std::vector<lng>> again(V + 1);
+        EXPECT_EQ(graphS.Johnson(chosen.size(), again), distancesS);
+    }
+
+    GraphS graph(edges, V);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+    EXPECT_EQ(distances[1][4], 10000000000LL + 4); // 1 -> 5 -> 3 -> 4
+    EXPECT_EQ(distances[1][5], 3);
+}
+
+#if JOHNSON_STATS
+TEST(GraphJohnsonAlgorithmTest, RunStats)
+{
+    int V = 6, E = 8;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 3 });
+    edges.push_back({ 2, 3, -2 });
+    edges.push_back({ 3, 1, 4 });
+    edges.push_back({ 1, 3, 2 });
+    edges.push_back({ 3, 4, 1 });
+    edges.push_back({ 4, 5, 5 });
+    edges.push_back({ 2, 5, 9 });
+    edges.push_back({ 5, 6, -1 });
+
+    GraphS graphS(edges, V);
+    GraphMT graphMT(edges, V, 2);
+    std::vector<std::vector<lng>> pathsS(V + 1), pathsMT(V + 1);
+    graphS.Johnson(E, pathsS);
+    graphMT.Johnson(E, pathsMT);
+
+    JohnsonStats stats = graphS.Stats();
+    EXPECT_GT(stats.bellmanFordPasses, 0);
+    EXPECT_EQ(stats.counters.relaxations, graphS.Relaxations());
+    EXPECT_EQ(stats.counters.pushes, stats.counters.pops); // every entry leaves the heap
+    EXPECT_LE(stats.counters.stalePops, stats.counters.decreaseKeys);
+    EXPECT_GT(stats.counters.decreaseKeys, 0); // 1 -> 3 is improved by 1 -> 2 -> 3
+
+    // the same searches on the workers count the same work
+    const SearchCounters& counters = graphMT.Stats().counters;
+    EXPECT_EQ(counters.relaxations, stats.counters.relaxations);
+    EXPECT_EQ(counters.pushes, stats.counters.pushes);
+    EXPECT_EQ(counters.stalePops, stats.counters.stalePops);
+    EXPECT_EQ(counters.decreaseKeys, stats.counters.decreaseKeys);
+
+    // potentials are kept, the second run does no Bellman-Ford pass
+    graphS.Johnson(E, pathsS);
+    EXPECT_EQ(graphS.Stats().bellmanFordPasses, 0);
+    EXPECT_EQ(graphS.Stats().counters.relaxations, stats.counters.relaxations);
+}
+#endif
+
+TEST(GraphMTJohnsonAlgorithmTest, ChromeTrace)
+{
+    int V = 5, E = 6;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 2 });
+    edges.push_back({ 2, 3, -1 });
+    edges.push_back({ 3, 1, 3 });
+    edges.push_back({ 3, 4, 2 });
+    edges.push_back({ 4, 5, 1 });
+    edges.push_back({ 5, 4, 1 });
+
+    GraphMT graph(edges, V, 2);
+    std::vector<std::vector<lng>> paths(V + 1);
+
+    Trace::Clear();
+    Trace::Enable(true);
+    graph.Johnson(E, paths);
+    Trace::Enable(false);
+
+    std::ostringstream out;
+    Trace::Write(out);
+    std::string trace = out.str();
+    Trace::Clear();
+
+    // pool tasks, their enqueue events and the solver phases are on the timeline
+    EXPECT_EQ(trace.find("{\"traceEvents\": ["), 0);
+    EXPECT_NE(trace.find("\"name\": \"task\", \"ph\": \"X\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\": \"enqueue\", \"ph\": \"i\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\": \"sources\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\": \"dijkstra\""), std::string::npos);
+
+    // nothing is recorded while tracing is off
+    Trace::Instant("off");
+    std::ostringstream off;
+    Trace::Write(off);
+    EXPECT_EQ(off.str().find("\"name\": \"off\""), std::string::npos);
+}
+
+#if JOHNSON_STATS
+TEST(GraphJohnsonAlgorithmTest, MemoryPerPhase)
+{
+    int V = 6, E = 7;
+    std::vector<Edge> edges;
+
+    edges.push_back({ 1, 2, 4 });
+    edges.push_back({ 2, 3, -2 });
+    edges.push_back({ 3, 1, 1 });
+    edges.push_back({ 3, 4, 2 });
+    edges.push_back({ 4, 5, 3 });
+    edges.push_back({ 5, 6, 1 });
+    edges.push_back({ 6, 4, 0 });
+
+    GraphS graph(edges, V);
+    std::vector<std::vector<lng>> paths(V + 1);
+    graph.Johnson(E, paths);
+    const JohnsonStats& stats = graph.Stats();
+
+    auto phase = [&](const std::string& name) {
+        for (const auto& memory : stats.memory)
+            if (memory.first == name)
+                return memory.second;
+        return MemoryCounters();
+    };
+
+    // the reduced adjacency is built in reweight and still live, the heaps of dijkstra are freed
+    MemoryCounters reweight = phase("reweight");
+    EXPECT_GE(reweight.allocated, (lng)((V + 2 + 2 * E) * sizeof(lng)));
+    EXPECT_GE(reweight.allocations, 3);
+    EXPECT_GE(reweight.peak, reweight.allocated);
+
+    MemoryCounters dijkstra = phase("dijkstra");
+    EXPECT_GT(dijkstra.allocations, 0);
+    EXPECT_EQ(dijkstra.live, reweight.live);
+    EXPECT_GT(dijkstra.peak, dijkstra.live);
+
+    EXPECT_EQ(stats.resultBytes, 2 * (V + 1) * (V + 1) * (lng)sizeof(lng));
+    EXPECT_GE(stats.graphBytes, (lng)(E * sizeof(Edge)));
+#ifdef __linux__
+    EXPECT_GT(stats.peakResidentKilobytes, 0);
+#endif
+}
+#endif
+
+TEST(GraphJohnsonAlgorithmTest, PooledHeaps)
+{
+    // a ladder: every source reaches every vertex, so every heap grows several times
+    int V = 200;
+    std::vector<Edge> edges;
+    for (int i = 1; i < V; i++) {
+        edges.push_back({ i, i + 1, 3 });
+        edges.push_back({ i + 1, i, -1 });
+        if (i + 2 <= V)
+            edges.push_back({ i, i + 2, 5 });
+    }
+    lng E = edges.size();
+
+    GraphS single(edges, V);
+    std::vector<std::vector<lng>> singlePaths(V + 1);
+    std::vector<std::vector<lng>> expected = single.Johnson(E, singlePaths);
+
+    // all memory of the run goes through the resource given to the graph
+    CountingResource resource;
+    GraphMT graph(edges, V, 2);
+    graph.SetMemoryResource(&resource);
+    std::vector<std::vector<lng>> paths(V + 1);
+    MemoryCounters before = MemoryAccounting::Snapshot();
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+    MemoryCounters after = MemoryAccounting::Snapshot();
+    MemoryCounters used = resource.Counters();
+
+    EXPECT_EQ(distances, expected);
+    EXPECT_EQ(paths, singlePaths);
+    EXPECT_GT(after.allocations, before.allocations);
+
+    // the arenas took their blocks from the resource and gave them all back,
+    // and the heaps of a worker reuse the blocks of its previous sources
+    EXPECT_GT(used.allocations, 0);
+    EXPECT_LT(used.allocations, V);
+    EXPECT_EQ(used.live, 0);
+    EXPECT_GT(used.peak, 0);
+
+#if JOHNSON_STATS
+    bool dijkstra = false;
+    for (const auto& memory : graph.Stats().memory) {
+        if (memory.first == "dijkstra") {
+            dijkstra = true;
+            EXPECT_GT(memory.second.allocations, 0);
+            EXPECT_LT(memory.second.allocations, V);
+        }
+    }
+    EXPECT_TRUE(dijkstra);
+#endif
+}
+
+TEST(GraphMTJohnsonAlgorithmTest, PlacementOptions)
+{
+    int V = 300;
+    std::vector<Edge> edges;
+    for (int i = 1; i < V; i++) {
+        edges.push_back({ i, i + 1, 3 });
+        edges.push_back({ i + 1, i, -1 });
+        if (i + 7 <= V)
+            edges.push_back({ i, i + 7, 20 });
+    }
+    lng E = edges.size();
+
+    EXPECT_GE(Placement::NodeCount(), 1);
+    EXPECT_GE(Placement::CurrentNode(), 0);
+    EXPECT_LT(Placement::CurrentNode(), Placement::NodeCount());
+    EXPECT_LT(Placement::WorkerCpu(0), (int)std::max(1u, std::thread::hardware_concurrency()));
+
+    GraphS single(edges, V);
+    std::vector<std::vector<lng>> singlePaths(V + 1);
+    std::vector<std::vector<lng>> expected = single.Johnson(E, singlePaths);
+
+    // placement moves memory and threads, never results
+    PlacementOptions placement;
+    placement.pinWorkers = true;
+    placement.firstTouch = true;
+    placement.replicateCsr = true;
+    Placement::EnableHugePages(true);
+    CountedVector<lng> large(Placement::HUGE_PAGE / sizeof(lng) * 2, 1);
+    GraphMT graph(edges, V, 3, 1, placement);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graph.Johnson(E, paths);
+
+    // batches of sources place their rows and read the replicas the same way
+    GraphMT batched(edges, V, 3, 4, placement);
+    std::vector<std::vector<lng>> batchedPaths(V + 1);
+    std::vector<std::vector<lng>> batchedDistances = batched.Johnson(E, batchedPaths);
+    Placement::EnableHugePages(false);
+
+    EXPECT_EQ(large.back(), 1);
+    EXPECT_EQ(distances, expected);
+    for (int i = 1; i <= V; i++)
+        EXPECT_EQ(paths[i], singlePaths[i]);
+    EXPECT_EQ(batchedDistances, expected);
+    EXPECT_EQ(batched.WorkerBusyTime().size(), 3);
+}
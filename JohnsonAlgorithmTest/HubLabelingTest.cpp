@@ -0,0 +1,34 @@
+#include "pch.h"
+#include <random>
+#include <vector>
+#include "..\JohnsonAlgorithm\Edge.h"
+#include "..\JohnsonAlgorithm\GraphS.h"
+#include "..\JohnsonAlgorithm\HubLabeling.h"
+
+
+TEST(HubLabelingTest, MatchesJohnson)
+{
+    int V = 80, E = 400;
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> dis_vertex(1, V);
+    std::uniform_int_distribution<> dis_weight(1, 20);
+
+    std::vector<Edge> edges;
+    for (int i = 0; i < E; ++i)
+        edges.push_back({ dis_vertex(gen), dis_vertex(gen), dis_weight(gen) });
+
+    GraphS graphS(edges, V);
+    std::vector<std::vector<lng>> paths(V + 1);
+    std::vector<std::vector<lng>> distances = graphS.Johnson(E, paths);
+
+    HubLabeling serial(edges, V);
+    HubLabeling parallel(edges, V, true);
+    EXPECT_EQ(serial.LabelEntries(), parallel.LabelEntries());
+
+    for (int s = 1; s <= V; ++s) {
+        for (int t = 1; t <= V; ++t) {
+            EXPECT_EQ(serial.Query(s, t), distances[s][t]);
+            EXPECT_EQ(parallel.Query(s, t), distances[s][t]);
+        }
+    }
+}
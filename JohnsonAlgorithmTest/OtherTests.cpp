@@ -1,6 +1,11 @@
 #include "pch.h"
+#include <sstream>
+#include "..\JohnsonAlgorithm\CommandLine.h"
 #include "..\JohnsonAlgorithm\Edge.h"
 #include "..\JohnsonAlgorithm\GenerateFile.h"
+#include "..\JohnsonAlgorithm\PerfCounters.h"
+#include "..\JohnsonAlgorithm\ResultWriter.h"
+#include "..\JohnsonAlgorithm\ThreadPool.h"
 
 TEST(EdgeTest, EdgeTest)
 {
@@ -14,4 +19,183 @@ TEST(EdgeTest, EdgeTest)
 TEST(GenerateFileTest, GenerateFileTest)
 {
 	EXPECT_EQ(generateFile(), 0);
+}
+
+TEST(PerfScopeTest, DegradesWithoutCounters)
+{
+	// disabled scopes never touch the counters
+	PerfScope off;
+	EXPECT_FALSE(off.Read().valid);
+
+	// enabled scopes read the events where perf_event_open is allowed, and stay invalid elsewhere
+	PerfScope::Enable(true);
+	PerfScope on;
+	volatile long long sum = 0;
+	for (int i = 0; i < 100000; i++)
+		sum += i;
+	HardwareCounters events = on.Read();
+	PerfScope::Enable(false);
+
+	if (events.valid)
+		EXPECT_GT(events.instructions + events.cycles, 0);
+	else
+		EXPECT_EQ(events.instructions, 0);
+	EXPECT_EQ(sum, 4999950000LL);
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinBucketWidth)
+{
+	LatencyHistogram histogram;
+	for (lng value = 1; value <= 1000; value++)
+		histogram.Record(value);
+
+	EXPECT_EQ(histogram.Count(), 1000);
+	EXPECT_EQ(histogram.Max(), 1000);
+	EXPECT_GE(histogram.Percentile(0.5), 500);
+	EXPECT_LE(histogram.Percentile(0.5), 500 * 9 / 8);
+	EXPECT_GE(histogram.Percentile(0.99), 990);
+	EXPECT_LE(histogram.Percentile(1.0), 1000);
+
+	// every value lies in the range of its bucket
+	for (lng value : { 0LL, 7LL, 8LL, 9LL, 1000LL, 123456789LL, 1LL << 40 }) {
+		int bucket = LatencyHistogram::Bucket(value);
+		EXPECT_GE(LatencyHistogram::BucketMax(bucket), value);
+		EXPECT_TRUE(bucket == 0 || LatencyHistogram::BucketMax(bucket - 1) < value);
+	}
+}
+
+TEST(ThreadPoolTest, MetricsSnapshot)
+{
+	ThreadPool pool(2);
+	const int TASKS = 20;
+	Latch done(TASKS);
+	std::atomic<lng> sum{ 0 };
+	std::atomic<int> outside{ 0 };
+	for (int i = 0; i < TASKS; i++) {
+		pool.Submit([&, i] {
+			sum += i;
+			int worker = ThreadPool::WorkerIndex();
+			if (worker < 0 || worker >= 2)
+				outside++;
+			done.CountDown();
+		});
+	}
+	done.Wait();
+
+	// a task is counted right after it returns, which may be after its count down
+	ThreadPoolMetrics metrics = pool.Metrics();
+	for (int attempt = 0; attempt < 1000 && metrics.completed < TASKS; attempt++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		metrics = pool.Metrics();
+	}
+
+	EXPECT_EQ(sum, TASKS * (TASKS - 1) / 2);
+	EXPECT_EQ(outside, 0);
+	EXPECT_EQ(ThreadPool::WorkerIndex(), -1);
+	EXPECT_EQ(metrics.submitted, TASKS);
+	EXPECT_EQ(metrics.completed, TASKS);
+	EXPECT_EQ(metrics.queueDepth, 0);
+	EXPECT_GE(metrics.peakQueueDepth, 1);
+	EXPECT_EQ(metrics.idleMicroseconds.size(), 2);
+	EXPECT_EQ(metrics.queueWait.Count(), TASKS);
+	EXPECT_EQ(metrics.execution.Count(), TASKS);
+	EXPECT_LE(metrics.execution.Percentile(0.5), metrics.execution.Max());
+}
+
+TEST(CommandLineTest, ParsesOptions)
+{
+	const char* arguments[] = { "johnson", "--engine", "s", "--threads", "2", "--format", "dimacs",
+		"--queries", "q.txt", "--output", "binary", "--out", "result.bin", "--stats", "stats.json", "--pin" };
+	CommandLine options;
+	std::string error;
+	ASSERT_TRUE(CommandLine::Parse(16, (char**)arguments, options, error));
+
+	EXPECT_EQ(options.engine, "s");
+	EXPECT_EQ(options.threads, 2);
+	EXPECT_EQ(options.inputFormat, InputFormat::Dimacs);
+	EXPECT_EQ(options.queries, "q.txt");
+	EXPECT_EQ(options.output, OutputFormat::Binary);
+	EXPECT_EQ(options.outputPath, "result.bin");
+	EXPECT_EQ(options.statsPath, "stats.json");
+	EXPECT_TRUE(options.placement.pinWorkers);
+	EXPECT_FALSE(options.generate);
+
+	const char* unknown[] = { "johnson", "--engine", "fast" };
+	EXPECT_FALSE(CommandLine::Parse(3, (char**)unknown, options, error));
+	const char* missing[] = { "johnson", "--threads" };
+	EXPECT_FALSE(CommandLine::Parse(2, (char**)missing, options, error));
+	const char* suffix[] = { "johnson", "--threads", "4x" };
+	EXPECT_FALSE(CommandLine::Parse(3, (char**)suffix, options, error));
+	const char* zero[] = { "johnson", "--batch", "0" };
+	EXPECT_FALSE(CommandLine::Parse(3, (char**)zero, options, error));
+}
+
+TEST(CommandLineTest, ReadsGraphsAndQueries)
+{
+	std::istringstream dimacs("c example\np sp 3 2\na 1 2 5\na 2 3 -1\n");
+	std::vector<Edge> edges;
+	lng V;
+	std::string error;
+	ASSERT_TRUE(ReadGraph(dimacs, InputFormat::Dimacs, edges, V, error));
+	EXPECT_EQ(V, 3);
+	ASSERT_EQ(edges.size(), 2);
+	EXPECT_EQ(edges[1].weight, -1);
+
+	std::istringstream text("3 2\n1 2 5\n2 4 1\n");
+	EXPECT_FALSE(ReadGraph(text, InputFormat::Text, edges, V, error));
+
+	std::istringstream file("# all targets of 2\n2\n\n1 3\n");
+	std::vector<Query> queries;
+	ASSERT_TRUE(ReadQueries(file, 3, queries, error));
+	ASSERT_EQ(queries.size(), 2);
+	EXPECT_EQ(queries[0], Query(2, 0));
+	EXPECT_EQ(queries[1], Query(1, 3));
+
+	std::istringstream outside("4\n");
+	EXPECT_FALSE(ReadQueries(outside, 3, queries, error));
+	std::istringstream target("3 abc\n");
+	EXPECT_FALSE(ReadQueries(target, 3, queries, error));
+	std::istringstream extra("3 2 1\n");
+	EXPECT_FALSE(ReadQueries(extra, 3, queries, error));
+	std::istringstream spaces("3 2 \r\n");
+	EXPECT_TRUE(ReadQueries(spaces, 3, queries, error));
+}
+
+TEST(ResultWriterTest, FormatsInQueryOrder)
+{
+	// 1 -> 2 -> 3, nothing leaves 3
+	lng V = 3;
+	std::vector<std::vector<lng>> distances = { { 0, 0, 0, 0 }, { 0, 0, 5, 4 }, { 0, LLONG_MAX, 0, -1 }, { 0, LLONG_MAX, LLONG_MAX, 0 } };
+	std::vector<std::vector<lng>> paths = { {}, { 0, 1, 1, 2 }, { 0, -1, 2, 2 }, { 0, -1, -1, 3 } };
+	std::vector<Query> queries = { { 1, 0 }, { 3, 1 }, { 2, 3 } };
+
+	ResultWriter csv(OutputFormat::Csv, 1);
+	csv.Format(distances, paths, queries, V);
+	std::ostringstream out;
+	csv.Write(out);
+	EXPECT_EQ(out.str(), "source,target,distance,path\n1,1,0,1\n1,2,5,1 2\n1,3,4,1 2 3\n3,1,,\n2,3,-1,2 3\n");
+	EXPECT_EQ(csv.Bytes(), out.str().size());
+
+	// the chunks of several workers join to the same text
+	ResultWriter tsv(OutputFormat::Tsv, 3);
+	tsv.Format(distances, paths, queries, V);
+	std::ostringstream tabs;
+	tsv.Write(tabs);
+	std::string expected = out.str();
+	std::replace(expected.begin(), expected.end(), ',', '\t');
+	EXPECT_EQ(tabs.str(), expected);
+
+	// header, then 4 numbers per answer and the path vertices
+	ResultWriter binary(OutputFormat::Binary, 2);
+	binary.Format(distances, paths, queries, V);
+	EXPECT_EQ(binary.Bytes(), 4 + (5 * 4 + 1 + 2 + 3 + 0 + 2) * sizeof(lng));
+
+	std::string file = "result_writer_test.csv";
+	ASSERT_TRUE(csv.Write(file));
+	std::ifstream in(file, std::ios::binary);
+	std::stringstream written;
+	written << in.rdbuf();
+	EXPECT_EQ(written.str(), out.str());
+	in.close();
+	std::remove(file.c_str());
 }
\ No newline at end of file